@@ -6,6 +6,13 @@
 #include "ezgl/application.hpp"
 #include "ezgl/graphics.hpp"
 #include "globals.h"
+#include "benchmark.h"
+#include "memory_report.h"
+#include "trace.h"
+#include "map_cache.h"
+#include "map_loader.h"
+#include <cstdlib>
+#include <fstream>
 
 //Program exit codes
 constexpr int SUCCESS_EXIT_CODE = 0;        //Everyting went OK
@@ -15,6 +22,20 @@ constexpr int BAD_ARGUMENTS_EXIT_CODE = 2;  //Invalid command-line usage
 //The default map to load if none is specified
 std::string default_map_path = "/cad2/ece297s/public/maps/toronto_canada.streets.bin";
 
+//Writes the spans recorded this session to trace_path, if one was given
+bool saveTrace(const std::string& trace_path) {
+    if (trace_path.empty()) {
+        return true;
+    }
+    std::ofstream trace(trace_path);
+    if (!trace) {
+        std::cerr << "Failed to write trace '" << trace_path << "'\n";
+        return false;
+    }
+    writeTraceJson(trace);
+    return true;
+}
+
 // The start routine of your program (main) when you are running your standalone
 // mapper program. This main routine is *never called* when you are running 
 // ece297exercise (the unit tests) -- those tests have their own main routine
@@ -23,29 +44,126 @@ std::string default_map_path = "/cad2/ece297s/public/maps/toronto_canada.streets
 // will not be called!
 int main(int argc, char** argv) {
 
-    std::string map_path;
-    if(argc == 1) {
-        //Use a default map
-        map_path = default_map_path;
-    } else if (argc == 2) {
-        //Get the map from the command line
-        map_path = argv[1];
-    } else {
-        //Invalid arguments
-        std::cerr << "Usage: " << argv[0] << " [map_file_path]\n";
-        std::cerr << "  If no map_file_path is provided a default map is loaded.\n";
-        return BAD_ARGUMENTS_EXIT_CODE;
+    std::string map_path = default_map_path;
+    bool show_load_times = false;
+    bool show_tag_report = false;
+    bool keep_all_tags = false;
+    bool run_benchmarks = false;
+    bool show_memory_report = false;
+    std::string memory_json_path;
+    std::string trace_path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--load-times") {
+            //Print how long each loadMap phase took
+            show_load_times = true;
+        } else if (arg == "--tag-report") {
+            //Print how many OSM nodes, ways and tags were kept at load time
+            show_tag_report = true;
+        } else if (arg == "--all-tags") {
+            //Keep every OSM tag instead of only the ones the mapper draws
+            keep_all_tags = true;
+        } else if (arg == "--bench") {
+            //Time the map lookups against their brute force versions and exit
+            run_benchmarks = true;
+        } else if (arg == "--memory-report") {
+            //Print the heap memory held by each map structure
+            show_memory_report = true;
+        } else if (arg.rfind("--memory-json=", 0) == 0) {
+            //Write the same report as JSON to the given file
+            memory_json_path = arg.substr(std::string("--memory-json=").size());
+        } else if (arg.rfind("--map-cache-mb=", 0) == 0) {
+            //Memory budget for the maps kept resident when switching cities
+            setMapCacheBudget(std::strtoull(arg.c_str() + std::string("--map-cache-mb=").size(), nullptr, 10)*1024*1024);
+        } else if (arg == "--compress-geometry") {
+            //Keep street and feature shapes compressed, for big maps
+            compress_geometry = true;
+        } else if (arg == "--skip-snapshot-check") {
+            //Page a big map's snapshot in as it is used instead of checksumming it up front
+            check_snapshot_checksum = false;
+        } else if (arg.rfind("--trace=", 0) == 0) {
+            //Write the recorded spans as Chrome trace JSON on exit
+            trace_path = arg.substr(std::string("--trace=").size());
+        } else if (arg.rfind("--", 0) != 0 && map_path == default_map_path) {
+            //Get the map from the command line
+            map_path = arg;
+        } else {
+            //Invalid arguments
+            std::cerr << "Usage: " << argv[0] << " [map_file_path] [--load-times] [--tag-report] [--all-tags] [--bench] [--memory-report] [--memory-json=<path>] [--trace=<path>] [--map-cache-mb=<n>] [--compress-geometry] [--skip-snapshot-check]\n";
+            std::cerr << "  If no map_file_path is provided a default map is loaded.\n";
+            std::cerr << "  --load-times prints the time taken by each loadMap phase.\n";
+            std::cerr << "  --tag-report prints how many OSM nodes, ways and tags were kept.\n";
+            std::cerr << "  --all-tags keeps every OSM tag instead of only the ones drawn.\n";
+            std::cerr << "  --bench benchmarks the map lookups instead of opening the map.\n";
+            std::cerr << "  --memory-report prints the heap memory held by each map structure.\n";
+            std::cerr << "  --memory-json=<path> writes that memory report to a JSON file.\n";
+            std::cerr << "  --trace=<path> writes a Chrome trace of the session (needs a -DMAPPER_TRACE build).\n";
+            std::cerr << "  --map-cache-mb=<n> keeps switched away maps resident up to n MB (default " << MAP_CACHE_BUDGET_MB << ").\n";
+            std::cerr << "  --compress-geometry keeps street and feature shapes compressed, to fit bigger maps in memory.\n";
+            std::cerr << "  --skip-snapshot-check skips the map snapshot checksum, so a big map's snapshot is read as it is used.\n";
+            return BAD_ARGUMENTS_EXIT_CODE;
+        }
     }
 
+    if (!trace_path.empty() && !traceEnabled()) {
+        std::cerr << "Built without MAPPER_TRACE, the trace will be empty\n";
+    }
+
+    //Only keep the OSM tags the mapper draws, unless asked for all of them
+    if (!keep_all_tags) {
+        OSM_tag_projection = mapperTagProjection();
+    }
+
+    //Show the map as soon as the streets layer is loaded, the OSM layer (POIs and
+    //road classes) follows in the background. The reports need the whole map
+    defer_OSM_layer = !run_benchmarks && !show_tag_report && !show_memory_report && memory_json_path.empty();
+
     //Load the map and related data structures
     bool load_success = loadMap(map_path);
+    bool OSM_deferred = defer_OSM_layer;
+    defer_OSM_layer = false;
     if(!load_success) {
         std::cerr << "Failed to load map '" << map_path << "'\n";
         return ERROR_EXIT_CODE;
     }
+    if (OSM_deferred) {
+        startOSMLayerLoad();
+    }
+
+    if (show_load_times) {
+        std::cout << "loadMap phase times:\n";
+        printLoadPhaseTimes(std::cout);
+    }
+
+    if (show_tag_report) {
+        std::cout << "OSM tag projection:\n";
+        printTagProjectionReport(std::cout);
+    }
+
+    if (show_memory_report) {
+        std::cout << "Memory usage:\n";
+        printMemoryReport(std::cout, collectMemoryUsage());
+    }
+
+    if (!memory_json_path.empty()) {
+        std::ofstream json(memory_json_path);
+        if (!json) {
+            std::cerr << "Failed to write memory report '" << memory_json_path << "'\n";
+            return ERROR_EXIT_CODE;
+        }
+        writeMemoryReportJson(json, collectMemoryUsage());
+    }
 
     std::cout << "Successfully loaded map '" << map_path << "'\n";
 
+    if (run_benchmarks) {
+        std::cout << "Benchmarks:\n";
+        runBenchmarks(std::cout);
+        closeMap();
+        return saveTrace(trace_path) ? SUCCESS_EXIT_CODE : ERROR_EXIT_CODE;
+    }
+
     drawMap();
 
     //Clean-up the map data and related data structures
@@ -53,6 +171,6 @@ int main(int argc, char** argv) {
     
     closeMap(); 
 
-    return SUCCESS_EXIT_CODE;
+    return saveTrace(trace_path) ? SUCCESS_EXIT_CODE : ERROR_EXIT_CODE;
 }
 
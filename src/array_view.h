@@ -0,0 +1,44 @@
+#ifndef ARRAY_VIEW_H
+#define ARRAY_VIEW_H
+
+#include <cstddef>
+#include <vector>
+
+// Non-owning, read only view of a contiguous array (a minimal std::span,
+// which is C++20). Lets the m1 lookups hand out the vectors built in loadMap
+// without copying them. A view is only valid until the map is closed
+template <typename T>
+struct array_view{
+    const T* first = nullptr;
+    size_t count = 0;
+
+    array_view() = default;
+    array_view(const T* data, size_t size) : first(data), count(size) {}
+    array_view(const std::vector<T>& vec) : first(vec.data()), count(vec.size()) {}
+
+    const T* begin() const{
+        return first;
+    }
+
+    const T* end() const{
+        return first + count;
+    }
+
+    const T* data() const{
+        return first;
+    }
+
+    size_t size() const{
+        return count;
+    }
+
+    bool empty() const{
+        return count == 0;
+    }
+
+    const T& operator[](size_t i) const{
+        return first[i];
+    }
+};
+
+#endif /* ARRAY_VIEW_H */
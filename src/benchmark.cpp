@@ -0,0 +1,316 @@
+#include "benchmark.h"
+#include "globals.h"
+#include "distance_kernel.h"
+#include "geometry_blocks.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+// Helper Function Prototypes
+std::vector<LatLon> randomMapPositions(int count);
+IntersectionIdx findClosestIntersectionBruteForce(LatLon my_position);
+POIIdx findClosestPOIBruteForce(LatLon my_position, std::string poi_name);
+IntersectionIdx findClosestIntersectionBatch(const distance_batch& intersections, LatLon my_position);
+POIIdx findClosestPOIBatch(const distance_batch& POIs, LatLon my_position, std::string poi_name);
+std::vector<IntersectionIdx> findIntersectionsOfTwoStreetsMerge(std::pair<StreetIdx, StreetIdx> street_ids);
+void decodeAllPoints(const geometry_blocks& blocks, const std::vector<uint32_t>& offsets, std::vector<ezgl::point2d>& points);
+int countMovedPoints(const std::vector<ezgl::point2d>& points, const std::vector<double>& xs, const std::vector<double>& ys);
+void printBenchmarkResult(std::ostream& out, const char* name, int num_queries, double brute_ms, double fast_ms, int mismatches);
+void printBenchmarkResult(std::ostream& out, const char* name, int num_queries, double brute_ms, double fast_ms, int mismatches, double batch_ms, int batch_mismatches);
+
+void runBenchmarks(std::ostream& out){
+    benchmarkClosestIntersection(out, 2000);
+    benchmarkClosestPOI(out, 2000);
+    benchmarkIntersectionsOfTwoStreets(out, 20000);
+    benchmarkGeometryBlocks(out);
+}
+
+void benchmarkClosestIntersection(std::ostream& out, int num_queries){
+    if (getNumIntersections() == 0){
+        return;
+    }
+    std::vector<LatLon> queries = randomMapPositions(num_queries);
+    std::vector<IntersectionIdx> brute(num_queries), fast(num_queries), batch(num_queries);
+    // Built up front like the KD-tree, so only the queries are timed
+    distance_batch intersections;
+    for (int intersection = 0; intersection < getNumIntersections(); intersection++){
+        intersections.push_back(getIntersectionPosition(intersection));
+    }
+
+    auto const brute_start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_queries; i++){
+        brute[i] = findClosestIntersectionBruteForce(queries[i]);
+    }
+    auto const brute_end = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_queries; i++){
+        fast[i] = findClosestIntersection(queries[i]);
+    }
+    auto const fast_end = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_queries; i++){
+        batch[i] = findClosestIntersectionBatch(intersections, queries[i]);
+    }
+    auto const batch_end = std::chrono::high_resolution_clock::now();
+
+    int mismatches = 0, batch_mismatches = 0;
+    for (int i = 0; i < num_queries; i++){
+        mismatches += brute[i] != fast[i];
+        batch_mismatches += brute[i] != batch[i];
+    }
+    printBenchmarkResult(out, "findClosestIntersection", num_queries,
+        std::chrono::duration<double, std::milli>(brute_end - brute_start).count(),
+        std::chrono::duration<double, std::milli>(fast_end - brute_end).count(), mismatches,
+        std::chrono::duration<double, std::milli>(batch_end - fast_end).count(), batch_mismatches);
+}
+
+void benchmarkClosestPOI(std::ostream& out, int num_queries){
+    if (getNumPointsOfInterest() == 0){
+        return;
+    }
+    // Names of random POIs, so common names come up as often as they do on the map
+    std::vector<LatLon> queries = randomMapPositions(num_queries);
+    std::vector<std::string> names(num_queries);
+    std::mt19937 rng(297);
+    for (int i = 0; i < num_queries; i++){
+        names[i] = getPOIName(rng() % getNumPointsOfInterest());
+    }
+    std::vector<POIIdx> brute(num_queries), fast(num_queries), batch(num_queries);
+    distance_batch POIs;
+    for (POIIdx p = 0; p < getNumPointsOfInterest(); p++){
+        POIs.push_back(getPOIPosition(p));
+    }
+
+    auto const brute_start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_queries; i++){
+        brute[i] = findClosestPOIBruteForce(queries[i], names[i]);
+    }
+    auto const brute_end = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_queries; i++){
+        fast[i] = findClosestPOI(queries[i], names[i]);
+    }
+    auto const fast_end = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_queries; i++){
+        batch[i] = findClosestPOIBatch(POIs, queries[i], names[i]);
+    }
+    auto const batch_end = std::chrono::high_resolution_clock::now();
+
+    int mismatches = 0, batch_mismatches = 0;
+    for (int i = 0; i < num_queries; i++){
+        mismatches += brute[i] != fast[i];
+        batch_mismatches += brute[i] != batch[i];
+    }
+    printBenchmarkResult(out, "findClosestPOI", num_queries,
+        std::chrono::duration<double, std::milli>(brute_end - brute_start).count(),
+        std::chrono::duration<double, std::milli>(fast_end - brute_end).count(), mismatches,
+        std::chrono::duration<double, std::milli>(batch_end - fast_end).count(), batch_mismatches);
+}
+
+void benchmarkIntersectionsOfTwoStreets(std::ostream& out, int num_queries){
+    if (getNumStreetSegments() == 0){
+        return;
+    }
+    // Streets of random segments that share an intersection, so most pairs do cross
+    std::mt19937 rng(297);
+    std::vector<std::pair<StreetIdx, StreetIdx>> queries(num_queries);
+    for (int i = 0; i < num_queries; i++){
+        StreetSegmentInfo segment = getStreetSegmentInfo(rng() % getNumStreetSegments());
+        array_view<StreetSegmentIdx> others = streetSegmentsOfIntersection(segment.from);
+        queries[i] = std::make_pair(segment.streetID, getStreetSegmentInfo(others[rng() % others.size()]).streetID);
+    }
+    std::vector<std::vector<IntersectionIdx>> brute(num_queries), fast(num_queries);
+
+    auto const brute_start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_queries; i++){
+        brute[i] = findIntersectionsOfTwoStreetsMerge(queries[i]);
+    }
+    auto const brute_end = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_queries; i++){
+        fast[i] = findIntersectionsOfTwoStreets(queries[i]);
+    }
+    auto const fast_end = std::chrono::high_resolution_clock::now();
+
+    int mismatches = 0;
+    for (int i = 0; i < num_queries; i++){
+        mismatches += brute[i] != fast[i];
+    }
+    printBenchmarkResult(out, "findIntersectionsOfTwoStreets", num_queries,
+        std::chrono::duration<double, std::milli>(brute_end - brute_start).count(),
+        std::chrono::duration<double, std::milli>(fast_end - brute_end).count(), mismatches);
+}
+
+void benchmarkGeometryBlocks(std::ostream& out){
+    if (getNumStreetSegments() == 0){
+        return;
+    }
+    // Projected from the streets database, whichever form segment_geometry is in
+    std::vector<uint32_t> offsets(1, 0);
+    std::vector<double> xs, ys;
+    for (StreetSegmentIdx segment = 0; segment < getNumStreetSegments(); segment++){
+        StreetSegmentInfo segment_info = getStreetSegmentInfo(segment);
+        std::vector<LatLon> points(1, getIntersectionPosition(segment_info.from));
+        for (int c = 0; c < segment_info.numCurvePoints; c++){
+            points.push_back(getStreetSegmentCurvePoint(c, segment));
+        }
+        points.push_back(getIntersectionPosition(segment_info.to));
+        for (LatLon point : points){
+            xs.push_back(projection.x(point.longitude()));
+            ys.push_back(projection.y(point.latitude()));
+        }
+        offsets.push_back(xs.size());
+    }
+    geometry_blocks blocks;
+    blocks.build(offsets, xs.data(), ys.data(), projection.origin_x, projection.origin_y);
+    int num_queries = offsets.size() - 1;
+
+    std::vector<ezgl::point2d> brute(xs.size()), fast;
+
+    auto const brute_start = std::chrono::high_resolution_clock::now();
+    for (size_t p = 0; p < xs.size(); p++){
+        brute[p] = ezgl::point2d(xs[p], ys[p]);
+    }
+    auto const brute_end = std::chrono::high_resolution_clock::now();
+    decodeAllPoints(blocks, offsets, fast);
+    auto const fast_end = std::chrono::high_resolution_clock::now();
+
+    int mismatches = countMovedPoints(fast, xs, ys);
+    // One two vertex item, a store of only a few bytes
+    std::vector<uint32_t> tiny_offsets = {0, 2};
+    std::vector<double> tiny_xs = {projection.origin_x, projection.origin_x + 1.5};
+    std::vector<double> tiny_ys = {projection.origin_y, projection.origin_y - 2.25};
+    geometry_blocks tiny;
+    tiny.build(tiny_offsets, tiny_xs.data(), tiny_ys.data(), projection.origin_x, projection.origin_y);
+    std::vector<ezgl::point2d> tiny_points;
+    decodeAllPoints(tiny, tiny_offsets, tiny_points);
+    mismatches += countMovedPoints(tiny_points, tiny_xs, tiny_ys);
+
+    printBenchmarkResult(out, "geometry_blocks::points", num_queries,
+        std::chrono::duration<double, std::milli>(brute_end - brute_start).count(),
+        std::chrono::duration<double, std::milli>(fast_end - brute_end).count(), mismatches);
+}
+
+// ------------- Helper Functions -------------
+
+// Uniformly random positions inside the map bounds, the same ones on every run
+std::vector<LatLon> randomMapPositions(int count){
+    std::mt19937 rng(297);
+    std::uniform_real_distribution<double> lat(min_lat, max_lat);
+    std::uniform_real_distribution<double> lon(min_lon, max_lon);
+    std::vector<LatLon> positions(count);
+    for (int i = 0; i < count; i++){
+        positions[i] = LatLon(lat(rng), lon(rng));
+    }
+    return positions;
+}
+
+// The linear scan findClosestIntersection used before the KD-tree
+IntersectionIdx findClosestIntersectionBruteForce(LatLon my_position){
+    double shortest_distance = findDistanceBetweenTwoPoints(my_position, getIntersectionPosition(0));
+    IntersectionIdx closestintersection = 0;
+    for (int intersection = 0; intersection < getNumIntersections(); ++intersection) {
+        double checkdistance = findDistanceBetweenTwoPoints(my_position, getIntersectionPosition(intersection));
+        if (checkdistance < shortest_distance){
+            shortest_distance = checkdistance;
+            closestintersection = intersection;
+        }
+    }
+    return closestintersection;
+}
+
+// The linear scan findClosestPOI used before the per name KD-trees
+POIIdx findClosestPOIBruteForce(LatLon my_position, std::string poi_name){
+    double distance = -1;
+    POIIdx fcPOI = 0;
+    for (POIIdx p = 0; p < getNumPointsOfInterest(); p++){
+        if (poi_name.compare(getPOIName(p)) == 0){
+            double check_distance = findDistanceBetweenTwoPoints(my_position, getPOIPosition(p));
+            if (distance == -1 || check_distance < distance){
+                distance = check_distance;
+                fcPOI = p;
+            }
+        }
+    }
+    return fcPOI;
+}
+
+// The same scan over all intersections at once with the batch distance kernel
+IntersectionIdx findClosestIntersectionBatch(const distance_batch& intersections, LatLon my_position){
+    double shortest_distance;
+    return closestInBatch(my_position, intersections, shortest_distance);
+}
+
+// The same scan with the batch distance kernel. Names are only compared for
+// POIs closer than the best match so far
+POIIdx findClosestPOIBatch(const distance_batch& POIs, LatLon my_position, std::string poi_name){
+    static thread_local std::vector<double> distances;
+    distancesFrom(my_position, POIs, distances);
+    double distance = -1;
+    POIIdx fcPOI = 0;
+    for (POIIdx p = 0; p < getNumPointsOfInterest(); p++){
+        if ((distance == -1 || distances[p] < distance) && poi_name.compare(getPOIName(p)) == 0){
+            distance = distances[p];
+            fcPOI = p;
+        }
+    }
+    return fcPOI;
+}
+
+// The merge of the two sorted intersection lists used before the crossing index
+std::vector<IntersectionIdx> findIntersectionsOfTwoStreetsMerge(std::pair<StreetIdx, StreetIdx> street_ids){
+    std::vector<IntersectionIdx> common_intersections;
+    array_view<IntersectionIdx> st_one = intersectionsOfStreet(street_ids.first);
+    array_view<IntersectionIdx> st_two = intersectionsOfStreet(street_ids.second);
+    std::set_intersection(st_one.begin(), st_one.end(), st_two.begin(), st_two.end(), std::back_inserter(common_intersections));
+    return common_intersections;
+}
+
+// Every item of blocks back to back, in item order like the offsets it was built from
+void decodeAllPoints(const geometry_blocks& blocks, const std::vector<uint32_t>& offsets, std::vector<ezgl::point2d>& points){
+    points.clear();
+    for (size_t i = 0; i < blocks.size(); i++){
+        array_view<ezgl::point2d> item = blocks.points(i);
+        // An item of the wrong length shows up as moved points
+        if (item.size() != offsets[i + 1] - offsets[i]){
+            points.resize(offsets[i + 1], ezgl::point2d(NAN, NAN));
+            continue;
+        }
+        points.insert(points.end(), item.begin(), item.end());
+    }
+}
+
+// Points further than half a quantization step (and a rounding error) from
+// the coordinates they were built from
+int countMovedPoints(const std::vector<ezgl::point2d>& points, const std::vector<double>& xs, const std::vector<double>& ys){
+    double tolerance = 0.5/GEOMETRY_BLOCK_UNITS_PER_METER + 1e-6;
+    int moved = std::abs(int(points.size()) - int(xs.size()));
+    for (size_t p = 0; p < std::min(points.size(), xs.size()); p++){
+        moved += !(std::abs(points[p].x - xs[p]) <= tolerance && std::abs(points[p].y - ys[p]) <= tolerance);
+    }
+    return moved;
+}
+
+void printBenchmarkResult(std::ostream& out, const char* name, int num_queries, double brute_ms, double fast_ms, int mismatches){
+    out << "  " << name << ": " << num_queries << " queries, "
+        << 1000*brute_ms/num_queries << " us -> " << 1000*fast_ms/num_queries << " us per query ("
+        << brute_ms/fast_ms << "x)";
+    if (mismatches > 0){
+        out << ", " << mismatches << " results differ";
+    }
+    out << std::endl;
+}
+
+// With a third column for the brute force scan on the batch distance kernel,
+// its speedup over the scan and how many of its results differ from the scan
+// (near ties the kernel's rounding can break the other way)
+void printBenchmarkResult(std::ostream& out, const char* name, int num_queries, double brute_ms, double fast_ms, int mismatches, double batch_ms, int batch_mismatches){
+    out << "  " << name << ": " << num_queries << " queries, "
+        << 1000*brute_ms/num_queries << " us -> " << 1000*fast_ms/num_queries << " us per query ("
+        << brute_ms/fast_ms << "x)";
+    if (mismatches > 0){
+        out << ", " << mismatches << " results differ";
+    }
+    out << "; batch kernel " << 1000*batch_ms/num_queries << " us per query (" << brute_ms/batch_ms << "x)";
+    if (batch_mismatches > 0){
+        out << ", " << batch_mismatches << " batch results differ";
+    }
+    out << std::endl;
+}
@@ -0,0 +1,29 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <iostream>
+
+// Micro benchmarks of the map lookups against the straightforward versions
+// they replaced, run on the currently loaded map (mapper --bench)
+// Each benchmark checks that both versions agree and prints the per query latency
+
+// findClosestIntersection (KD-tree) vs scanning every intersection, with the
+// same scan on the batch distance kernel as a third column
+void benchmarkClosestIntersection(std::ostream& out, int num_queries);
+
+// findClosestPOI (per name KD-trees) vs scanning every POI, with the same
+// scan on the batch distance kernel as a third column
+void benchmarkClosestPOI(std::ostream& out, int num_queries);
+
+// findIntersectionsOfTwoStreets (street pair hash) vs merging the two streets' intersections
+void benchmarkIntersectionsOfTwoStreets(std::ostream& out, int num_queries);
+
+// Decoding every segment polyline from geometry_blocks vs reading the flat
+// coordinates, plus a store too small for the fast varint reads. Results
+// differ where a vertex moved by more than the block quantization allows
+void benchmarkGeometryBlocks(std::ostream& out);
+
+// Runs every benchmark
+void runBenchmarks(std::ostream& out);
+
+#endif /* BENCHMARK_H */
@@ -0,0 +1,84 @@
+#ifndef CSR_TABLE_H
+#define CSR_TABLE_H
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "array_view.h"
+#include "mapped_vector.h"
+
+// One to many relation in compressed sparse row form: row r owns
+// values[offsets[r]] to values[offsets[r + 1]]. Replaces a vector of vectors
+// with two allocations, so it is cache friendly and frees in O(1)
+//
+// Built with a counting pass, values are kept in push order within a row:
+//   table.beginCount(rows);
+//   for (...) table.count(row);         // or count(row, n) for n values at once
+//   table.endCount();
+//   for (...) table.push(row, value);   // same rows, same order. Pushes to
+//                                       // different rows may run in parallel
+//   table.endPush();
+template <typename T>
+struct csr_table{
+    mapped_vector<uint32_t> offsets;
+    mapped_vector<T> values;
+
+    size_t size() const{
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+    array_view<T> operator[](size_t row) const{
+        return array_view<T>(values.data() + offsets[row], offsets[row + 1] - offsets[row]);
+    }
+
+    // While building, offsets[row + 2] counts row and after endCount
+    // offsets[row + 1] is the next free position of row. Once every row is
+    // full it has moved up to the end of row, which is what offsets[row + 1] means
+    void beginCount(size_t rows){
+        offsets.assign(rows + 2, 0);
+        values.clear();
+    }
+
+    void count(size_t row, uint32_t num_values = 1){
+        offsets[row + 2] += num_values;
+    }
+
+    void endCount(){
+        for (size_t i = 2; i < offsets.size(); i++){
+            offsets[i] += offsets[i - 1];
+        }
+        values.resize(offsets.back());
+    }
+
+    void push(size_t row, const T& value){
+        values[offsets[row + 1]++] = value;
+    }
+
+    void endPush(){
+        offsets.pop_back();
+    }
+
+    // Sorts each row and drops its duplicates, shifting the later rows down
+    void sortUniqueRows(){
+        uint32_t out = 0;
+        for (size_t row = 0; row + 1 < offsets.size(); row++){
+            auto first = values.begin() + offsets[row];
+            auto last = values.begin() + offsets[row + 1];
+            std::sort(first, last);
+            last = std::unique(first, last);
+            offsets[row] = out;
+            out = std::move(first, last, values.begin() + out) - values.begin();
+        }
+        if (!offsets.empty()){
+            offsets.back() = out;
+        }
+        values.resize(out);
+    }
+
+    void clear(){
+        offsets.clear();
+        values.clear();
+    }
+};
+
+#endif /* CSR_TABLE_H */
@@ -0,0 +1,126 @@
+#include "distance_kernel.h"
+#include <algorithm>
+#include <cmath>
+#include "StreetsDatabaseAPI.h"
+
+// Points per block closestInBatch ranks at a time, small enough to stay in L1
+#define DISTANCE_BLOCK 256
+
+// Helper Function Prototypes
+void squaredDistancesFrom(LatLon query, const distance_batch& batch, size_t lo, size_t hi, double* squared);
+double blockMinimum(const double* values, size_t num_values);
+
+void distance_batch::build(const std::vector<LatLon>& positions){
+    clear();
+    lon.reserve(positions.size());
+    lat.reserve(positions.size());
+    half_cos.reserve(positions.size());
+    half_sin.reserve(positions.size());
+    for (LatLon position : positions){
+        push_back(position);
+    }
+}
+
+void distance_batch::push_back(LatLon position){
+    double lat_rad = kDegreeToRadian*position.latitude();
+    lon.push_back(kDegreeToRadian*position.longitude());
+    lat.push_back(lat_rad);
+    half_cos.push_back(std::cos(lat_rad/2));
+    half_sin.push_back(std::sin(lat_rad/2));
+}
+
+void distance_batch::clear(){
+    lon.clear();
+    lat.clear();
+    half_cos.clear();
+    half_sin.clear();
+}
+
+// Squared distances in radians^2 to points lo to hi of batch, the metric every
+// query below ranks by
+void squaredDistancesFrom(LatLon query, const distance_batch& batch, size_t lo, size_t hi, double* squared){
+    double query_lat = kDegreeToRadian*query.latitude();
+    double query_lon = kDegreeToRadian*query.longitude();
+    double query_cos = std::cos(query_lat/2);
+    double query_sin = std::sin(query_lat/2);
+    const double* lon = batch.lon.data() + lo;
+    const double* lat = batch.lat.data() + lo;
+    const double* half_cos = batch.half_cos.data() + lo;
+    const double* half_sin = batch.half_sin.data() + lo;
+    size_t num_points = hi - lo;
+
+    #pragma omp simd
+    for (size_t i = 0; i < num_points; i++){
+        double cos_mean_lat = query_cos*half_cos[i] - query_sin*half_sin[i];
+        double dx = (lon[i] - query_lon)*cos_mean_lat;
+        double dy = lat[i] - query_lat;
+        squared[i] = dx*dx + dy*dy;
+    }
+}
+
+void distancesFrom(LatLon query, const distance_batch& batch, std::vector<double>& distances){
+    distances.resize(batch.size());
+    squaredDistancesFrom(query, batch, 0, batch.size(), distances.data());
+    double* out = distances.data();
+    size_t num_points = distances.size();
+    #pragma omp simd
+    for (size_t i = 0; i < num_points; i++){
+        out[i] = kEarthRadiusInMeters*std::sqrt(out[i]);
+    }
+}
+
+// Smallest of num_values values, num_values must be at least 1. Four
+// running minimums instead of one, so the compares don't wait on each other
+double blockMinimum(const double* values, size_t num_values){
+    double lane_min[4] = {values[0], values[0], values[0], values[0]};
+    size_t i = 0;
+    for (; i + 4 <= num_values; i += 4){
+        for (int lane = 0; lane < 4; lane++){
+            lane_min[lane] = values[i + lane] < lane_min[lane] ? values[i + lane] : lane_min[lane];
+        }
+    }
+    for (; i < num_values; i++){
+        lane_min[0] = values[i] < lane_min[0] ? values[i] : lane_min[0];
+    }
+    return std::min(std::min(lane_min[0], lane_min[1]), std::min(lane_min[2], lane_min[3]));
+}
+
+int closestInBatch(LatLon query, const distance_batch& batch, double& distance){
+    size_t num_points = batch.size();
+    if (num_points == 0){
+        return -1;
+    }
+    // Block by block, and only blocks that beat the best so far are searched
+    // for the index of their minimum, so ties still go to the smaller index
+    double squared[DISTANCE_BLOCK];
+    double min_squared = 0;
+    size_t closest = num_points;
+    for (size_t lo = 0; lo < num_points; lo += DISTANCE_BLOCK){
+        size_t hi = std::min(num_points, lo + DISTANCE_BLOCK);
+        squaredDistancesFrom(query, batch, lo, hi, squared);
+        double block_min = blockMinimum(squared, hi - lo);
+        if (closest == num_points || block_min < min_squared){
+            min_squared = block_min;
+            closest = lo + (std::find(squared, squared + (hi - lo), block_min) - squared);
+        }
+    }
+
+    distance = kEarthRadiusInMeters*std::sqrt(min_squared);
+    return int(closest);
+}
+
+std::vector<int> kClosestInBatch(LatLon query, const distance_batch& batch, size_t k){
+    std::vector<double> squared(batch.size());
+    squaredDistancesFrom(query, batch, 0, batch.size(), squared.data());
+
+    std::vector<int> closest(batch.size());
+    for (size_t i = 0; i < closest.size(); i++){
+        closest[i] = int(i);
+    }
+    k = std::min(k, closest.size());
+    std::partial_sort(closest.begin(), closest.begin() + k, closest.end(), [&squared](int a, int b){
+        return squared[a] < squared[b] || (squared[a] == squared[b] && a < b);
+    });
+    closest.resize(k);
+    return closest;
+}
@@ -0,0 +1,42 @@
+#ifndef DISTANCE_KERNEL_H
+#define DISTANCE_KERNEL_H
+
+#include <vector>
+#include "LatLon.h"
+
+// A set of points laid out for distance queries from one point to all of them
+//
+// lon/lat are in radians and half_cos/half_sin are cos/sin of half of each
+// latitude, in separate flat arrays so distancesFrom runs over them with SIMD.
+// The cosine of the mean latitude findDistanceBetweenTwoPoints scales
+// longitude by comes from cos((a + b)/2) = cos(a/2)cos(b/2) - sin(a/2)sin(b/2),
+// so a query needs no cos per point. Distances match findDistanceBetweenTwoPoints
+// up to rounding
+struct distance_batch{
+    std::vector<double> lon;
+    std::vector<double> lat;
+    std::vector<double> half_cos;
+    std::vector<double> half_sin;
+
+    void build(const std::vector<LatLon>& positions);
+
+    void push_back(LatLon position);
+
+    size_t size() const{
+        return lon.size();
+    }
+
+    void clear();
+};
+
+// Fills distances with the distance in meters from query to each point of batch
+void distancesFrom(LatLon query, const distance_batch& batch, std::vector<double>& distances);
+
+// Returns the index of the point of batch closest to query (ties go to the
+// smaller index) and sets distance to it, or -1 if batch is empty
+int closestInBatch(LatLon query, const distance_batch& batch, double& distance);
+
+// Returns the indices of the k points of batch closest to query, closest first
+std::vector<int> kClosestInBatch(LatLon query, const distance_batch& batch, size_t k);
+
+#endif /* DISTANCE_KERNEL_H */
@@ -0,0 +1,106 @@
+#include "feature_geometry.h"
+#include <algorithm>
+#include <cmath>
+#include "StreetsDatabaseAPI.h"
+
+void feature_geometry_store::outline(size_t feature, std::vector<ezgl::point2d>& points) const{
+    if (!packed.empty()){
+        array_view<ezgl::point2d> view = packed.points(feature);
+        points.assign(view.begin(), view.end());
+        return;
+    }
+    points.resize(numPoints(feature));
+    for (size_t i = 0, j = offsets[feature]; i < points.size(); i++, j++){
+        points[i] = projection.load(xs[j], ys[j]);
+    }
+}
+
+void feature_geometry_store::pack(){
+    if (!packed.empty() || size() == 0){
+        return;
+    }
+    std::vector<double> loaded_xs(xs.size()), loaded_ys(ys.size());
+    for (size_t i = 0; i < xs.size(); i++){
+        loaded_xs[i] = projection.loadX(xs[i]);
+        loaded_ys[i] = projection.loadY(ys[i]);
+    }
+    packed.build(offsets, loaded_xs.data(), loaded_ys.data(), projection.origin_x, projection.origin_y);
+    xs = std::vector<geometry_coord>();
+    ys = std::vector<geometry_coord>();
+}
+
+void feature_geometry_store::unpack(){
+    if (packed.empty()){
+        return;
+    }
+    xs.resize(offsets.back());
+    ys.resize(offsets.back());
+
+    // A block at a time, copying out the features it holds
+    csr_table<uint32_t> block_items;
+    block_items.beginCount(packed.numBlocks());
+    for (size_t f = 0; f < packed.size(); f++){
+        block_items.count(packed.item_blocks[f]);
+    }
+    block_items.endCount();
+    for (size_t f = 0; f < packed.size(); f++){
+        block_items.push(packed.item_blocks[f], f);
+    }
+    block_items.endPush();
+
+    std::vector<ezgl::point2d> points;
+    for (size_t b = 0; b < packed.numBlocks(); b++){
+        packed.decodeBlock(b, points);
+        for (uint32_t f : block_items[b]){
+            for (uint32_t p = 0; p < packed.item_counts[f]; p++){
+                ezgl::point2d point = points[packed.item_firsts[f] + p];
+                xs[offsets[f] + p] = projection.storeX(point.x);
+                ys[offsets[f] + p] = projection.storeY(point.y);
+            }
+        }
+    }
+    packed.clear();
+}
+
+void feature_geometry_store::clear(){
+    offsets.clear();
+    xs.clear();
+    ys.clear();
+    packed.clear();
+    areas.clear();
+    min_xs.clear();
+    min_ys.clear();
+    max_xs.clear();
+    max_ys.clear();
+    closed.clear();
+}
+
+double outlineArea(const double* lon, const double* lat, const double* half_cos, const double* half_sin, size_t num_points){
+    if (num_points < 2){
+        return 0;
+    }
+    // Twice the area in radians^2, each term is (x1 + x2)*(y2 - y1)
+    double twice_area = 0;
+    size_t num_edges = num_points - 1;
+    #pragma omp simd reduction(+:twice_area)
+    for (size_t i = 0; i < num_edges; i++){
+        double cos_mean_lat = half_cos[i]*half_cos[i + 1] - half_sin[i]*half_sin[i + 1];
+        twice_area += (lon[i] + lon[i + 1])*cos_mean_lat*(lat[i + 1] - lat[i]);
+    }
+    return std::abs(twice_area)*kEarthRadiusInMeters*kEarthRadiusInMeters/2;
+}
+
+void outlineBounds(const double* xs, const double* ys, size_t num_points, double& min_x, double& min_y, double& max_x, double& max_y){
+    double low_x = xs[0], low_y = ys[0], high_x = xs[0], high_y = ys[0];
+    #pragma omp simd reduction(min:low_x, low_y) reduction(max:high_x, high_y)
+    for (size_t i = 1; i < num_points; i++){
+        low_x = std::min(low_x, xs[i]);
+        low_y = std::min(low_y, ys[i]);
+        high_x = std::max(high_x, xs[i]);
+        high_y = std::max(high_y, ys[i]);
+    }
+    min_x = low_x;
+    min_y = low_y;
+    max_x = high_x;
+    max_y = high_y;
+}
@@ -0,0 +1,70 @@
+#ifndef FEATURE_GEOMETRY_H
+#define FEATURE_GEOMETRY_H
+
+#include <cstdint>
+#include <vector>
+#include "ezgl/point.hpp"
+#include "ezgl/rectangle.hpp"
+#include "projection.h"
+#include "geometry_blocks.h"
+#include "csr_table.h"
+#include "mapped_vector.h"
+
+// Outline, area, bounds and closed flag of every feature, built in one pass
+// in loadMap (loadFeatureData) so drawing and findFeatureArea don't go back to
+// the streets database
+//
+// Feature f owns xs/ys[offsets[f]] to xs/ys[offsets[f + 1]], its stored
+// vertices (see geometry_coord in projection.h), with x and y in separate
+// flat arrays. areas[f] is findFeatureArea (0 if the outline isn't closed),
+// min/max_xs/ys[f] its bounding box in projected xy and closed[f] whether its
+// first and last vertex are the same point. Once packed the vertices are in
+// packed instead (see geometry_blocks.h) and xs/ys are empty
+struct feature_geometry_store{
+    mapped_vector<uint32_t> offsets;
+    mapped_vector<geometry_coord> xs;
+    mapped_vector<geometry_coord> ys;
+    geometry_blocks packed;
+    mapped_vector<double> areas;
+    mapped_vector<double> min_xs;
+    mapped_vector<double> min_ys;
+    mapped_vector<double> max_xs;
+    mapped_vector<double> max_ys;
+    mapped_vector<uint8_t> closed;
+
+    size_t size() const{
+        return areas.size();
+    }
+
+    size_t numPoints(size_t feature) const{
+        return offsets[feature + 1] - offsets[feature];
+    }
+
+    // Whether the bounding box of feature touches rect
+    bool overlaps(size_t feature, const ezgl::rectangle& rect) const{
+        return min_xs[feature] <= rect.right() && max_xs[feature] >= rect.left()
+            && min_ys[feature] <= rect.top() && max_ys[feature] >= rect.bottom();
+    }
+
+    // Fills points with the projected outline of feature, for fill_poly
+    void outline(size_t feature, std::vector<ezgl::point2d>& points) const;
+
+    // Moves the vertices into packed, or back out of it (to within a centimetre)
+    void pack();
+    void unpack();
+
+    void clear();
+};
+
+// ------------- Kernels over one outline -------------
+
+// Shoelace area in m^2 of a closed outline of num_points lat/lon vertices (in
+// radians), with the x of each edge scaled by the cosine of its mean latitude.
+// half_cos/half_sin are cos/sin of half of each latitude, so that cosine comes
+// from cos((a + b)/2) = cos(a/2)cos(b/2) - sin(a/2)sin(b/2) without a cos per edge
+double outlineArea(const double* lon, const double* lat, const double* half_cos, const double* half_sin, size_t num_points);
+
+// Bounding box of num_points xy vertices, num_points must be at least 1
+void outlineBounds(const double* xs, const double* ys, size_t num_points, double& min_x, double& min_y, double& max_x, double& max_y);
+
+#endif /* FEATURE_GEOMETRY_H */
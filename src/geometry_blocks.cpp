@@ -0,0 +1,271 @@
+#include "geometry_blocks.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Helper Function Prototypes
+uint64_t zOrderKey(uint32_t x, uint32_t y);
+void putVarint(mapped_vector<uint8_t>& bytes, uint64_t value);
+uint64_t getVarint(const uint8_t*& in, const uint8_t* fast_end);
+
+// Interleaves the low 16 bits of x and y
+uint64_t zOrderKey(uint32_t x, uint32_t y){
+    uint64_t key = 0;
+    for (int bit = 0; bit < 16; bit++){
+        key |= uint64_t((x >> bit) & 1) << (2*bit);
+        key |= uint64_t((y >> bit) & 1) << (2*bit + 1);
+    }
+    return key;
+}
+
+// 7 bits per byte, low bits first, the high bit set on every byte but the last
+void putVarint(mapped_vector<uint8_t>& bytes, uint64_t value){
+    while (value >= 0x80){
+        bytes.push_back(uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(uint8_t(value));
+}
+
+// Reads the varint at in and moves past it. Up to fast_end it loads 8 bytes,
+// finds the first one without the high bit and squeezes the 7 bit groups
+// before it together, with no branch per byte. A varint longer than 8 bytes
+// (a step of 2^56 units or more), the last few bytes of a store and all of
+// a store under 8 bytes (fast_end is null then) are read one byte at a time,
+// so nothing is read past its end
+inline uint64_t getVarint(const uint8_t*& in, const uint8_t* fast_end){
+    if (fast_end != nullptr && in <= fast_end){
+        uint64_t word;
+        std::memcpy(&word, in, sizeof(word));
+        uint64_t last_bytes = ~word & 0x8080808080808080ULL;
+        if (last_bytes != 0){
+            int length = __builtin_ctzll(last_bytes)/8 + 1;
+            if (length < 8){
+                word &= (uint64_t(1) << (8*length)) - 1;
+            }
+            in += length;
+            return (word & 0x7f) | ((word >> 1) & (0x7fULL << 7)) | ((word >> 2) & (0x7fULL << 14))
+                | ((word >> 3) & (0x7fULL << 21)) | ((word >> 4) & (0x7fULL << 28)) | ((word >> 5) & (0x7fULL << 35))
+                | ((word >> 6) & (0x7fULL << 42)) | ((word >> 7) & (0x7fULL << 49));
+        }
+    }
+    uint64_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do{
+        byte = *in++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte >= 0x80);
+    return value;
+}
+
+void geometry_blocks::build(array_view<uint32_t> offsets, const double* xs, const double* ys, double x_origin, double y_origin){
+    clear();
+    origin_x = x_origin;
+    origin_y = y_origin;
+    size_t num_items = offsets.empty() ? 0 : offsets.size() - 1;
+    if (num_items == 0){
+        return;
+    }
+
+    // Z-order key of each item's first vertex on a 65536 x 65536 grid over the map
+    double min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+    bool first = true;
+    for (size_t i = 0; i < num_items; i++){
+        if (offsets[i] == offsets[i + 1]){
+            continue;
+        }
+        double x = xs[offsets[i]], y = ys[offsets[i]];
+        min_x = first ? x : std::min(min_x, x);
+        min_y = first ? y : std::min(min_y, y);
+        max_x = first ? x : std::max(max_x, x);
+        max_y = first ? y : std::max(max_y, y);
+        first = false;
+    }
+    double cell_x = std::max(max_x - min_x, 1.0)/65535;
+    double cell_y = std::max(max_y - min_y, 1.0)/65535;
+    std::vector<std::pair<uint64_t, uint32_t>> order(num_items);
+    for (size_t i = 0; i < num_items; i++){
+        uint64_t key = 0;
+        if (offsets[i] != offsets[i + 1]){
+            key = zOrderKey(uint32_t((xs[offsets[i]] - min_x)/cell_x), uint32_t((ys[offsets[i]] - min_y)/cell_y));
+        }
+        order[i] = std::make_pair(key, uint32_t(i));
+    }
+    std::sort(order.begin(), order.end());
+
+    item_blocks.resize(num_items);
+    item_firsts.resize(num_items);
+    item_counts.resize(num_items);
+    std::vector<uint64_t> steps_x, steps_y;
+    int64_t last_x = 0, last_y = 0;
+    // Writes the x steps of the block, then its y steps
+    auto endBlock = [&](){
+        block_offsets.push_back(bytes.size());
+        for (uint64_t step : steps_x){
+            putVarint(bytes, step);
+        }
+        block_y_offsets.push_back(bytes.size());
+        for (uint64_t step : steps_y){
+            putVarint(bytes, step);
+        }
+        block_vertices.push_back(steps_x.size());
+        steps_x.clear();
+        steps_y.clear();
+        last_x = 0;
+        last_y = 0;
+    };
+
+    for (const auto& entry : order){
+        uint32_t item = entry.second;
+        if (steps_x.size() >= GEOMETRY_BLOCK_VERTICES){
+            endBlock();
+        }
+        item_blocks[item] = block_vertices.size();
+        item_firsts[item] = steps_x.size();
+        item_counts[item] = offsets[item + 1] - offsets[item];
+
+        for (uint32_t j = offsets[item]; j < offsets[item + 1]; j++){
+            int64_t x = std::llround((xs[j] - origin_x)*GEOMETRY_BLOCK_UNITS_PER_METER);
+            int64_t y = std::llround((ys[j] - origin_y)*GEOMETRY_BLOCK_UNITS_PER_METER);
+            int64_t dx = x - last_x, dy = y - last_y;
+            // Zig-zag, so small negative steps get short varints too
+            steps_x.push_back((uint64_t(dx) << 1) ^ uint64_t(dx >> 63));
+            steps_y.push_back((uint64_t(dy) << 1) ^ uint64_t(dy >> 63));
+            last_x = x;
+            last_y = y;
+        }
+    }
+    endBlock();
+    block_offsets.push_back(bytes.size());
+    bytes.shrink_to_fit();
+}
+
+void geometry_blocks::decodeBlock(size_t block, std::vector<ezgl::point2d>& points) const{
+    size_t num_points = block_vertices[block];
+    static thread_local std::vector<int64_t> xs, ys;
+    xs.resize(num_points);
+    ys.resize(num_points);
+    int64_t* steps_x = xs.data();
+    int64_t* steps_y = ys.data();
+
+    // The x and y streams are read side by side, so the two chains of varint
+    // lengths overlap
+    const uint8_t* in_x = bytes.data() + block_offsets[block];
+    const uint8_t* in_y = bytes.data() + block_y_offsets[block];
+    const uint8_t* fast_end = bytes.size() >= 8 ? bytes.data() + bytes.size() - 8 : nullptr;
+    for (size_t p = 0; p < num_points; p++){
+        steps_x[p] = int64_t(getVarint(in_x, fast_end));
+        steps_y[p] = int64_t(getVarint(in_y, fast_end));
+    }
+
+    // Undo the zig-zag, then sum the steps back into positions
+    #pragma omp simd
+    for (size_t p = 0; p < num_points; p++){
+        steps_x[p] = int64_t(uint64_t(steps_x[p]) >> 1) ^ -(steps_x[p] & 1);
+        steps_y[p] = int64_t(uint64_t(steps_y[p]) >> 1) ^ -(steps_y[p] & 1);
+    }
+    for (size_t p = 1; p < num_points; p++){
+        steps_x[p] += steps_x[p - 1];
+        steps_y[p] += steps_y[p - 1];
+    }
+
+    points.resize(num_points);
+    ezgl::point2d* out = points.data();
+    double base_x = origin_x, base_y = origin_y;
+    #pragma omp simd
+    for (size_t p = 0; p < num_points; p++){
+        out[p].x = base_x + double(steps_x[p])/GEOMETRY_BLOCK_UNITS_PER_METER;
+        out[p].y = base_y + double(steps_y[p])/GEOMETRY_BLOCK_UNITS_PER_METER;
+    }
+}
+
+array_view<ezgl::point2d> geometry_blocks::points(size_t item) const{
+    uint32_t block = item_blocks[item];
+    if (cache_slots.size() != numBlocks()){
+        cache_slots.assign(numBlocks(), -1);
+    }
+
+    int32_t slot = cache_slots[block];
+    if (slot < 0){
+        if (cache.size() < GEOMETRY_BLOCK_CACHE){
+            slot = cache.size();
+            cache.emplace_back();
+        }
+        else{
+            slot = 0;
+            for (size_t s = 1; s < cache.size(); s++){
+                if (cache[s].last_used < cache[slot].last_used){
+                    slot = s;
+                }
+            }
+            cache_slots[cache[slot].block] = -1;
+        }
+        cache[slot].block = block;
+        decodeBlock(block, cache[slot].points);
+        cache_slots[block] = slot;
+    }
+    cache[slot].last_used = ++cache_clock;
+    return array_view<ezgl::point2d>(cache[slot].points.data() + item_firsts[item], item_counts[item]);
+}
+
+void geometry_blocks::gather(const std::vector<uint32_t>& items, std::vector<ezgl::point2d>& points, std::vector<uint32_t>& firsts) const{
+    firsts.resize(items.size() + 1);
+    firsts[0] = 0;
+    for (size_t k = 0; k < items.size(); k++){
+        firsts[k + 1] = firsts[k] + item_counts[items[k]];
+    }
+    points.resize(firsts.back());
+
+    // Positions in items grouped by block (a counting sort), so each block is
+    // decoded once and its items copied out together
+    static thread_local std::vector<uint32_t> block_starts, order;
+    block_starts.assign(numBlocks() + 1, 0);
+    for (uint32_t item : items){
+        block_starts[item_blocks[item] + 1]++;
+    }
+    for (size_t b = 0; b < numBlocks(); b++){
+        block_starts[b + 1] += block_starts[b];
+    }
+    order.resize(items.size());
+    for (size_t k = 0; k < items.size(); k++){
+        order[block_starts[item_blocks[items[k]]]++] = k;
+    }
+
+    static thread_local std::vector<ezgl::point2d> decoded;
+    const ezgl::point2d* block_points = nullptr;
+    uint32_t last_block = 0;
+    for (size_t j = 0; j < order.size(); j++){
+        uint32_t k = order[j];
+        uint32_t item = items[k];
+        uint32_t block = item_blocks[item];
+        if (j == 0 || block != last_block){
+            // A block points() still has cached doesn't need decoding again
+            if (cache_slots.size() == numBlocks() && cache_slots[block] >= 0){
+                block_points = cache[cache_slots[block]].points.data();
+            }
+            else{
+                decodeBlock(block, decoded);
+                block_points = decoded.data();
+            }
+            last_block = block;
+        }
+        std::copy(block_points + item_firsts[item], block_points + item_firsts[item] + item_counts[item], points.begin() + firsts[k]);
+    }
+}
+
+void geometry_blocks::clear(){
+    origin_x = 0;
+    origin_y = 0;
+    bytes.clear();
+    block_offsets.clear();
+    block_y_offsets.clear();
+    block_vertices.clear();
+    item_blocks.clear();
+    item_firsts.clear();
+    item_counts.clear();
+    cache.clear();
+    cache_slots.clear();
+    cache_clock = 0;
+}
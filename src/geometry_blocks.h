@@ -0,0 +1,84 @@
+#ifndef GEOMETRY_BLOCKS_H
+#define GEOMETRY_BLOCKS_H
+
+#include <cstdint>
+#include <vector>
+#include "ezgl/point.hpp"
+#include "array_view.h"
+#include "mapped_vector.h"
+
+// Polylines (segment shapes or feature outlines) compressed into blocks, the
+// form segment_geometry and feature_geometry take with compress_geometry set
+//
+// Items are sorted along a Z-order curve of their first vertex and cut into
+// blocks of about GEOMETRY_BLOCK_VERTICES vertices, so a block covers a small
+// part of the map and drawing one part touches few blocks. Vertices are
+// quantized to 1/GEOMETRY_BLOCK_UNITS_PER_METER steps from the origin, and a
+// block stores each one as the zig-zag varints of its x and y step from the
+// vertex before it (from the origin for the first vertex of the block).
+//
+// Block b decodes to block_vertices[b] points. Its x steps are
+// bytes[block_offsets[b]] to bytes[block_y_offsets[b]] and its y steps run
+// from there to bytes[block_offsets[b + 1]], two streams so the decoder can
+// read both at once. Item i is the item_counts[i] points from point
+// item_firsts[i] of block item_blocks[i].
+//
+// points() decodes blocks on demand and keeps the last GEOMETRY_BLOCK_CACHE
+// of them, evicting the least recently used. Items come in Z-order, so a loop
+// over many items by id keeps missing that cache; gather() them instead, it
+// decodes each block they touch once. The cache is only for the UI thread;
+// decodeBlock is safe to call from anywhere
+#define GEOMETRY_BLOCK_VERTICES 256
+#define GEOMETRY_BLOCK_UNITS_PER_METER 100
+#define GEOMETRY_BLOCK_CACHE 64
+
+struct geometry_blocks{
+    double origin_x = 0;
+    double origin_y = 0;
+    mapped_vector<uint8_t> bytes;
+    mapped_vector<uint32_t> block_offsets;
+    mapped_vector<uint32_t> block_y_offsets;
+    mapped_vector<uint32_t> block_vertices;
+    mapped_vector<uint32_t> item_blocks;
+    mapped_vector<uint32_t> item_firsts;
+    mapped_vector<uint32_t> item_counts;
+
+    // Decoded blocks, cache_slots[b] is the index of block b in cache or -1
+    struct decoded_block{
+        uint32_t block;
+        uint64_t last_used;
+        std::vector<ezgl::point2d> points;
+    };
+    mutable std::vector<decoded_block> cache;
+    mutable std::vector<int32_t> cache_slots;
+    mutable uint64_t cache_clock = 0;
+
+    // Compresses the polylines item i = xs/ys[offsets[i]] to xs/ys[offsets[i + 1]]
+    void build(array_view<uint32_t> offsets, const double* xs, const double* ys, double origin_x, double origin_y);
+
+    size_t size() const{
+        return item_blocks.size();
+    }
+
+    bool empty() const{
+        return item_blocks.empty();
+    }
+
+    size_t numBlocks() const{
+        return block_vertices.size();
+    }
+
+    // Fills points with every point of block
+    void decodeBlock(size_t block, std::vector<ezgl::point2d>& points) const;
+
+    // Points of item, valid until the next points() call
+    array_view<ezgl::point2d> points(size_t item) const;
+
+    // Fills points with the points of every item in items, going block by
+    // block. Item items[k] is points[firsts[k]] to points[firsts[k + 1]]
+    void gather(const std::vector<uint32_t>& items, std::vector<ezgl::point2d>& points, std::vector<uint32_t>& firsts) const;
+
+    void clear();
+};
+
+#endif /* GEOMETRY_BLOCKS_H */
@@ -13,6 +13,7 @@
 #include <list>
 #include <queue>
 #include <unordered_map>
+#include <atomic>
 
 
 #include "m1.h"
@@ -24,34 +25,123 @@
 #include "ezgl/graphics.hpp"
 
 #include "m3.h"
+#include "osm_tag_store.h"
+#include "osm_tag_projection.h"
+#include "array_view.h"
+#include "csr_table.h"
+#include "point_store.h"
+#include "segment_geometry.h"
+#include "feature_geometry.h"
+#include "street_prefix_index.h"
+#include "street_fuzzy_index.h"
+#include "latlon_kd_tree.h"
+#include "poi_name_index.h"
+#include "street_crossing_index.h"
+#include "projection.h"
+#include "map_arena.h"
+#include "map_snapshot.h"
+#include "mapped_vector.h"
 
 // Global Variables
-struct point_data{
-    ezgl::point2d pos;
-    std::string name;
-    bool highlight = false;
-};
-
-extern double avg_lat;
 extern double max_lat, min_lat, max_lon, min_lon;
 
-extern std::vector<point_data> intersection_data;
-extern std::vector<point_data> POI_data;
-extern std::vector<std::pair<point_data, point_data>> segment_intersections;
-extern std::vector<std::vector<StreetSegmentIdx>> street_segments_of_street; 
+extern point_store intersection_data;
+extern point_store POI_data;
+// (from, to) intersections of each street segment
+extern mapped_vector<std::pair<IntersectionIdx, IntersectionIdx>> segment_intersections;
+extern segment_geometry_store segment_geometry;
+extern csr_table<StreetSegmentIdx> street_segments_of_street;
 extern std::vector<gboolean> POI_on;
 extern std::vector<StreetSegmentIdx> nav_segments;
-extern std::vector<std::pair<double, std::vector<ezgl::point2d>>> feature_data;
+extern feature_geometry_store feature_geometry;
+
+// Derived data built in m1.cpp that is also read/written by the map snapshot cache
+extern csr_table<StreetSegmentIdx> intersection_street_segments;
+extern csr_table<IntersectionIdx> street_intersections;
+extern street_crossing_index street_crossings;
+extern mapped_vector<double> street_travel_time;
+extern mapped_vector<double> street_lengths;
+extern street_prefix_index street_name_index;
+extern street_fuzzy_index street_fuzzy_names;
+extern latlon_kd_tree intersection_tree;
+extern poi_name_index POI_name_index;
+extern string_pool street_name_pool;
+extern mapped_vector<uint32_t> street_name_ids;
+extern osm_tag_store OSM_node_tags;
+extern osm_tag_store OSM_way_tags;
+extern osm_id_index OSM_way_index;
+extern mapped_vector<double> OSM_way_length;
+extern osm_tag_projection_report OSM_tag_report;
+
+// Tags kept by the OSM loaders, set before loadMap
+extern osm_tag_projection OSM_tag_projection;
+
+// Streets database path of the current map, empty if none is open
+extern std::string loaded_map_path;
+
+// Staged loading: with defer_OSM_layer set loadMap only loads the streets
+// layer, and loadOSMLayer (safe to run on another thread while the map is
+// drawn) adds the OSM database and tag indexes. Until OSM_layer_loaded is
+// set nothing may read the OSM structures or call the OSM API
+extern bool defer_OSM_layer;
+extern std::atomic<bool> OSM_layer_loaded;
+bool loadOSMLayer();
+
+// switchMap brings a parked map back with its OSM tag indexes but leaves the
+// OSM database closed, as the queries above don't need it. Call
+// openOSMDatabase before using the OSM API directly, false if it won't open
+extern std::string closed_OSM_database;
+bool openOSMDatabase();
+
+// With compress_geometry set loadMap keeps the segment polylines and feature
+// outlines in compressed blocks (see geometry_blocks.h), for big maps or
+// several resident ones. Rounds the geometry to the centimetre
+extern bool compress_geometry;
 
 // Global Helper Functions
 std::string toLowerRemoveSpace(std::string input_string);
 
-std::string getOSMWayTagValue(OSMID osm_id, std::string key);
+std::string getOSMWayTagValue(OSMID osm_id, std::string_view key);
+
+// Zero-copy versions of m1 lookups, the views are valid until the map is closed
+array_view<IntersectionIdx> intersectionsOfStreet(StreetIdx street_id);
+
+array_view<StreetSegmentIdx> streetSegmentsOfIntersection(IntersectionIdx intersection_id);
+
+void intersectionsOfTwoStreets(std::pair<StreetIdx, StreetIdx> street_ids, std::vector<IntersectionIdx>& common_intersections);
+
+std::vector<street_crossing> findAllStreetCrossings(array_view<StreetIdx> streets1, array_view<StreetIdx> streets2);
+
+std::string_view getOSMNodeTagView(OSMID osm_id, std::string_view key);
+
+std::string_view getOSMWayTagView(OSMID osm_id, std::string_view key);
+
+std::string_view streetNameView(StreetIdx street_id);
+
+array_view<StreetIdx> streetIdsFromPartialStreetName(std::string_view street_prefix, size_t offset, size_t limit);
+
+// Latency budget of a fuzzy street search, in microseconds
+#define FUZZY_BUDGET_US 2000
+
+std::vector<fuzzy_street_match> findFuzzyStreetMatches(std::string_view street_prefix, size_t max_results);
+
+std::vector<IntersectionIdx> findClosestIntersections(LatLon my_position, size_t k);
+
+std::vector<IntersectionIdx> findIntersectionsWithinRadius(LatLon my_position, double radius);
+
+double x_from_lon (double lon);
+
+double y_from_lat (double lat);
+
+double lat_from_y(double y);
+
+double lon_from_x(double x);
 
-double x_from_lon (float lon);
+// closeMap without freeing the maps parked by switchMap (see map_cache.h)
+void closeCurrentMap();
 
-double y_from_lat (float lat);
+void printLoadPhaseTimes(std::ostream& out);
 
-double lat_from_y(float y);
+void printTagProjectionReport(std::ostream& out);
 
-double lon_from_x(float x);
+osm_tag_projection mapperTagProjection();
@@ -0,0 +1,242 @@
+#include "latlon_kd_tree.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+#include "m1.h"
+#include "StreetsDatabaseAPI.h"
+
+// A found point, ordered by distance then id so ties resolve like a brute force scan
+typedef std::pair<double, int> kd_hit;
+
+// State of one query while it walks the tree
+struct kd_query{
+    const latlon_kd_tree* tree;
+    LatLon position;
+    // Meters per degree along each axis, lower bounds for longitude
+    double lat_scale;
+    double lon_scale;
+};
+
+// Helper Function Prototypes
+void buildKdRange(latlon_kd_tree& tree, std::vector<int32_t>& order, const std::vector<LatLon>& positions, size_t lo, size_t hi);
+kd_query makeKdQuery(const latlon_kd_tree& tree, LatLon position);
+double splitDistance(const kd_query& query, size_t mid, bool& go_left);
+void searchNearest(const kd_query& query, size_t lo, size_t hi, kd_hit& best);
+void searchKNearest(const kd_query& query, size_t lo, size_t hi, size_t k, std::priority_queue<kd_hit>& best);
+void searchRadius(const kd_query& query, size_t lo, size_t hi, double radius, std::vector<kd_hit>& found);
+
+void latlon_kd_tree::build(const std::vector<LatLon>& positions){
+    std::vector<uint32_t> range_offsets = {0, uint32_t(positions.size())};
+    buildRanges(positions, range_offsets);
+}
+
+void latlon_kd_tree::buildRanges(const std::vector<LatLon>& positions, array_view<uint32_t> range_offsets){
+    clear();
+    if (positions.empty()){
+        return;
+    }
+
+    std::vector<int32_t> order(positions.size());
+    for (size_t i = 0; i < positions.size(); i++){
+        order[i] = i;
+        min_cos_lat = std::min(min_cos_lat, std::cos(kDegreeToRadian*positions[i].latitude()));
+    }
+    axis.resize(positions.size());
+    for (size_t r = 0; r + 1 < range_offsets.size(); r++){
+        buildKdRange(*this, order, positions, range_offsets[r], range_offsets[r + 1]);
+    }
+
+    points.resize(positions.size());
+    ids.assign(order.begin(), order.end());
+    for (size_t i = 0; i < order.size(); i++){
+        points[i] = positions[order[i]];
+    }
+}
+
+int latlon_kd_tree::nearest(LatLon position) const{
+    return nearestInRange(position, 0, points.size());
+}
+
+int latlon_kd_tree::nearestInRange(LatLon position, size_t lo, size_t hi) const{
+    if (lo >= hi){
+        return -1;
+    }
+    kd_query query = makeKdQuery(*this, position);
+    kd_hit best(HUGE_VAL, -1);
+    searchNearest(query, lo, hi, best);
+    return best.second;
+}
+
+std::vector<int> latlon_kd_tree::kNearest(LatLon position, size_t k) const{
+    std::vector<int> result;
+    if (points.empty() || k == 0){
+        return result;
+    }
+    kd_query query = makeKdQuery(*this, position);
+    // Max heap, the furthest of the best k so far is on top
+    std::priority_queue<kd_hit> best;
+    searchKNearest(query, 0, points.size(), k, best);
+
+    result.resize(best.size());
+    for (size_t i = result.size(); i > 0; i--){
+        result[i - 1] = best.top().second;
+        best.pop();
+    }
+    return result;
+}
+
+std::vector<int> latlon_kd_tree::withinRadius(LatLon position, double radius) const{
+    std::vector<int> result;
+    if (points.empty()){
+        return result;
+    }
+    kd_query query = makeKdQuery(*this, position);
+    std::vector<kd_hit> found;
+    searchRadius(query, 0, points.size(), radius, found);
+
+    std::sort(found.begin(), found.end());
+    for (auto const& hit : found){
+        result.push_back(hit.second);
+    }
+    return result;
+}
+
+void latlon_kd_tree::clear(){
+    points.clear();
+    ids.clear();
+    axis.clear();
+    min_cos_lat = 1;
+}
+
+// ------------- Helper Functions -------------
+
+// Splits order[lo, hi) on its median along the axis with the larger spread (in meters)
+void buildKdRange(latlon_kd_tree& tree, std::vector<int32_t>& order, const std::vector<LatLon>& positions, size_t lo, size_t hi){
+    if (hi - lo <= 1){
+        if (hi > lo){
+            tree.axis[lo] = 0;
+        }
+        return;
+    }
+
+    double min_lat = HUGE_VAL, max_lat = -HUGE_VAL, min_lon = HUGE_VAL, max_lon = -HUGE_VAL;
+    for (size_t i = lo; i < hi; i++){
+        LatLon p = positions[order[i]];
+        min_lat = std::min(min_lat, p.latitude());
+        max_lat = std::max(max_lat, p.latitude());
+        min_lon = std::min(min_lon, p.longitude());
+        max_lon = std::max(max_lon, p.longitude());
+    }
+    uint8_t split = (max_lon - min_lon)*tree.min_cos_lat > (max_lat - min_lat) ? 1 : 0;
+
+    size_t mid = lo + (hi - lo)/2;
+    std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi, [&](int32_t a, int32_t b){
+        double coord_a = split == 0 ? positions[a].latitude() : positions[a].longitude();
+        double coord_b = split == 0 ? positions[b].latitude() : positions[b].longitude();
+        return coord_a != coord_b ? coord_a < coord_b : a < b;
+    });
+    tree.axis[mid] = split;
+
+    buildKdRange(tree, order, positions, lo, mid);
+    buildKdRange(tree, order, positions, mid + 1, hi);
+}
+
+kd_query makeKdQuery(const latlon_kd_tree& tree, LatLon position){
+    kd_query query;
+    query.tree = &tree;
+    query.position = position;
+    query.lat_scale = kEarthRadiusInMeters*kDegreeToRadian;
+    // findDistanceBetweenTwoPoints scales longitude by the cos of the average latitude
+    // of the two points, which is never below the smaller cos of the two
+    query.lon_scale = query.lat_scale*std::min(tree.min_cos_lat, std::cos(kDegreeToRadian*position.latitude()));
+    return query;
+}
+
+// Lower bound on the distance from the query to any point on the far side of
+// node mid's split, and which side the query is on
+double splitDistance(const kd_query& query, size_t mid, bool& go_left){
+    LatLon split = query.tree->points[mid];
+    double diff;
+    if (query.tree->axis[mid] == 0){
+        diff = query.position.latitude() - split.latitude();
+        go_left = diff < 0;
+        return std::abs(diff)*query.lat_scale;
+    }
+    diff = query.position.longitude() - split.longitude();
+    go_left = diff < 0;
+    return std::abs(diff)*query.lon_scale;
+}
+
+void searchNearest(const kd_query& query, size_t lo, size_t hi, kd_hit& best){
+    if (lo >= hi){
+        return;
+    }
+    size_t mid = lo + (hi - lo)/2;
+    kd_hit hit(findDistanceBetweenTwoPoints(query.position, query.tree->points[mid]), query.tree->ids[mid]);
+    if (hit < best){
+        best = hit;
+    }
+
+    bool go_left;
+    double plane = splitDistance(query, mid, go_left);
+    if (go_left){
+        searchNearest(query, lo, mid, best);
+        if (plane <= best.first){
+            searchNearest(query, mid + 1, hi, best);
+        }
+    }
+    else{
+        searchNearest(query, mid + 1, hi, best);
+        if (plane <= best.first){
+            searchNearest(query, lo, mid, best);
+        }
+    }
+}
+
+void searchKNearest(const kd_query& query, size_t lo, size_t hi, size_t k, std::priority_queue<kd_hit>& best){
+    if (lo >= hi){
+        return;
+    }
+    size_t mid = lo + (hi - lo)/2;
+    kd_hit hit(findDistanceBetweenTwoPoints(query.position, query.tree->points[mid]), query.tree->ids[mid]);
+    if (best.size() < k){
+        best.push(hit);
+    }
+    else if (hit < best.top()){
+        best.pop();
+        best.push(hit);
+    }
+
+    bool go_left;
+    double plane = splitDistance(query, mid, go_left);
+    size_t near_lo = go_left ? lo : mid + 1;
+    size_t near_hi = go_left ? mid : hi;
+    size_t far_lo = go_left ? mid + 1 : lo;
+    size_t far_hi = go_left ? hi : mid;
+
+    searchKNearest(query, near_lo, near_hi, k, best);
+    if (best.size() < k || plane <= best.top().first){
+        searchKNearest(query, far_lo, far_hi, k, best);
+    }
+}
+
+void searchRadius(const kd_query& query, size_t lo, size_t hi, double radius, std::vector<kd_hit>& found){
+    if (lo >= hi){
+        return;
+    }
+    size_t mid = lo + (hi - lo)/2;
+    double distance = findDistanceBetweenTwoPoints(query.position, query.tree->points[mid]);
+    if (distance <= radius){
+        found.push_back(kd_hit(distance, query.tree->ids[mid]));
+    }
+
+    bool go_left;
+    double plane = splitDistance(query, mid, go_left);
+    if (go_left || plane <= radius){
+        searchRadius(query, lo, mid, radius, found);
+    }
+    if (!go_left || plane <= radius){
+        searchRadius(query, mid + 1, hi, radius, found);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef LATLON_KD_TREE_H
+#define LATLON_KD_TREE_H
+
+#include <cstdint>
+#include <vector>
+#include "LatLon.h"
+#include "array_view.h"
+#include "mapped_vector.h"
+
+// Static KD-tree over a set of LatLon positions, for nearest, k-nearest and
+// radius queries
+// The tree is implicit: the points are reordered so that the node for the
+// range [lo, hi) is its median at (lo + hi)/2, with the smaller half of the
+// split axis on its left and the rest on its right. axis[mid] is the axis that
+// node splits on (0 = latitude, 1 = longitude).
+//
+// A tree can also be a forest: buildRanges builds an independent tree over
+// each range of points, and the InRange queries only search one of them.
+//
+// Distances are exactly findDistanceBetweenTwoPoints, so results match a
+// brute force scan (ties go to the smaller id). Subtrees are pruned with the
+// distance to the splitting line, where a degree of longitude is scaled by the
+// smallest cos(latitude) a query can see
+struct latlon_kd_tree{
+    mapped_vector<LatLon> points;
+    mapped_vector<int32_t> ids;
+    mapped_vector<uint8_t> axis;
+    // Smallest cos(latitude) over all points
+    double min_cos_lat = 1;
+
+    // Builds the tree, point i gets id i
+    void build(const std::vector<LatLon>& positions);
+
+    // Builds one tree over each range of points positions[range_offsets[r]] to
+    // positions[range_offsets[r + 1]]. Point i gets id i and keeps its range
+    void buildRanges(const std::vector<LatLon>& positions, array_view<uint32_t> range_offsets);
+
+    // Returns the id of the closest point, or -1 if the tree is empty
+    int nearest(LatLon position) const;
+
+    // Returns the id of the closest point of the range [lo, hi) of a forest,
+    // or -1 if the range is empty
+    int nearestInRange(LatLon position, size_t lo, size_t hi) const;
+
+    // Returns the ids of the k closest points, closest first
+    std::vector<int> kNearest(LatLon position, size_t k) const;
+
+    // Returns the ids of all points within radius meters, closest first
+    std::vector<int> withinRadius(LatLon position, double radius) const;
+
+    size_t size() const{
+        return points.size();
+    }
+
+    void clear();
+};
+
+#endif /* LATLON_KD_TREE_H */
@@ -5,6 +5,7 @@
 #include <vector>
 #include <map>
 #include <algorithm>
+#include <iterator>
 #include <chrono>
 #include <sstream>
 #include <fstream>
@@ -13,12 +14,33 @@
 #include "m1.h"
 #include "StreetsDatabaseAPI.h"
 #include "OSMDatabaseAPI.h"
+#include "map_snapshot.h"
+#include "memory_report.h"
+#include "trace.h"
+#include "map_cache.h"
+#include "map_loader.h"
 
 //Helper Function Prototypes
 const OSMNode* getNodeByID(OSMID osm_id);
 const OSMWay* getWayByID(OSMID osm_id);
 bool strReplace(std::string& source, const std::string& from_str, const std::string& to_str);
-double cosLaw(double a, double b, double c);
+double localBearing(LatLon from, LatLon to);
+
+// loadMap phase prototypes
+template <typename Phase> void runLoadPhase(const char* name, Phase phase);
+void loadMapBounds();
+void loadIntersectionData();
+void loadSegmentGeometry();
+void loadStreetSegmentData();
+void loadStreetCrossings();
+void loadPOIData();
+void loadFeatureData();
+void loadGeometryBlocks();
+void loadStreetNames();
+void loadOSMNodes();
+void loadOSMWays();
+bool loadOSMPhases(const std::string& osm_path, bool from_snapshot);
+template <typename Entity> bool addProjectedTags(osm_tag_store& store, const Entity* entity);
 
 // ------------- Samiyah's Functions -------------
 
@@ -36,281 +58,804 @@ double cosLaw(double a, double b, double c);
 // name.
 
 // Global variables
-std::vector<std::vector<StreetSegmentIdx>> intersection_street_segments; 
-std::map<char, std::multimap<std::string, StreetIdx>> street_names; 
-std::unordered_map<OSMID, const OSMNode*> OSM_node_ID; 
-std::unordered_map<OSMID, std::unordered_map<std::string, std::string>> OSM_node_tags; 
-std::unordered_map<OSMID, std::unordered_map<std::string, std::string>> OSM_way_tags; 
-std::unordered_map<OSMID, double> OSM_way_length; 
-std::unordered_map<OSMID, const OSMWay*> OSM_way_ID; 
-std::vector<double> street_travel_time;
-std::vector<double> street_lengths;
-std::vector<std::vector<IntersectionIdx>> street_intersections;
-std::vector<point_data> intersection_data;
-std::vector<point_data> POI_data;
-std::vector<std::pair<point_data, point_data>> segment_intersections;
-std::vector<std::vector<StreetSegmentIdx>> street_segments_of_street; 
-std::vector<std::pair<double, std::vector<ezgl::point2d>>> feature_data;
-
-double avg_lat = 0;
+// Arena of the current map, first so it outlives everything allocated from it
+std::unique_ptr<map_arena> map_memory;
+// Snapshot the current map was read from, its structures may view it
+std::unique_ptr<snapshot_mapping> map_snapshot;
+// Relations below are in CSR form (see csr_table.h)
+csr_table<StreetSegmentIdx> intersection_street_segments;
+// Normalized street name prefix -> street ids, for findStreetIdsFromPartialStreetName
+street_prefix_index street_name_index;
+// Trigram index over the names in street_name_index, for typo tolerant search
+street_fuzzy_index street_fuzzy_names;
+// Display name of each street, as an id into street_name_pool
+string_pool street_name_pool;
+mapped_vector<uint32_t> street_name_ids;
+// OSMID -> node index, only needed while the way lengths are computed
+osm_id_index OSM_node_index;
+osm_tag_store OSM_node_tags; 
+osm_tag_store OSM_way_tags; 
+// OSMID -> way index, with the way lengths in a parallel array
+osm_id_index OSM_way_index;
+mapped_vector<double> OSM_way_length; 
+// Which tags the OSM loaders keep, and what they kept/dropped during the last load
+osm_tag_projection OSM_tag_projection;
+osm_tag_projection_report OSM_tag_report;
+mapped_vector<double> street_travel_time;
+mapped_vector<double> street_lengths;
+csr_table<IntersectionIdx> street_intersections;
+// Street pair -> intersections where they cross, for findIntersectionsOfTwoStreets
+street_crossing_index street_crossings;
+// Intersection and POI xy coordinates, names and highlights
+point_store intersection_data;
+// KD-tree over the intersection positions, for findClosestIntersection
+latlon_kd_tree intersection_tree;
+point_store POI_data;
+// POIs bucketed by name with a KD-tree per name, for findClosestPOI
+poi_name_index POI_name_index;
+mapped_vector<std::pair<IntersectionIdx, IntersectionIdx>> segment_intersections;
+// Projected polyline, length and end bearings of every street segment
+segment_geometry_store segment_geometry;
+csr_table<StreetSegmentIdx> street_segments_of_street;
+// Projected outline, area and bounds of every feature
+feature_geometry_store feature_geometry;
+// Streets database path of the current map, empty if none is open
+std::string loaded_map_path;
+map_load_progress load_progress;
+// Set before loadMap to leave the OSM layer to a later loadOSMLayer call
+bool defer_OSM_layer = false;
+// Set before loadMap to keep the segment and feature geometry compressed
+bool compress_geometry = false;
+// Whether the OSM database and tag indexes of the current map are loaded
+std::atomic<bool> OSM_layer_loaded{false};
+// OSM database of the current map when switchMap left it closed
+std::string closed_OSM_database;
+// What loadOSMLayer needs from the loadMap call that deferred it
+struct deferred_OSM_layer_load{
+    std::string streets_path;
+    std::string osm_path;
+    std::string snapshot_path;
+    bool from_snapshot = false;
+} deferred_OSM_layer;
+// Name and wall clock time (ms) of each phase of the last loadMap call
+std::vector<std::pair<std::string, double>> load_phase_times;
+
+map_projection projection;
 double max_lat, min_lat, max_lon, min_lon = 0;
 
 bool loadMap(std::string map_streets_database_filename) {
+    TRACE_SCOPE("loadMap");
+    auto const load_start = std::chrono::high_resolution_clock::now();
+    load_phase_times.clear();
+    OSM_tag_report = osm_tag_projection_report();
+    // Shared, the load phases below build their string pools concurrently
+    if (!map_memory){
+        map_memory = std::make_unique<map_arena>(std::pmr::new_delete_resource(), true);
+    }
+
     //false, Indicates whether the map has loaded 
-    bool load_successful = loadStreetsDatabaseBIN(map_streets_database_filename); 
+    bool load_successful = false;
+    runLoadPhase("Streets database", [&](){
+        load_successful = loadStreetsDatabaseBIN(map_streets_database_filename);
+    });
     bool load_OSM = false;
+    bool OSM_deferred = false;
 
     //Successfully loaded
     std::string from = ".streets.bin";
     std::string to = ".osm.bin";
     if(load_successful == true){
-        // auto const cp1 = std::chrono::high_resolution_clock::now();
+        std::string streets_path = map_streets_database_filename;
 
         // This following function call, strReplace, replaces the mapstreetdatadbasefilenanme from .string to .osm to use in osmload
         bool osmBinStringChange = strReplace(map_streets_database_filename, from, to);
 
-        // Loads osm database for use of osm header file functions, like return nodes, ways,etc
-        if (osmBinStringChange){
-            load_OSM = loadOSMDatabaseBIN(map_streets_database_filename);
+        // Reuse the derived structures from an earlier load of this map if its snapshot is still valid
+        std::string snapshot_path = snapshotPathForMap(streets_path);
+        bool from_snapshot = false;
+        runLoadPhase("Snapshot read", [&](){
+            from_snapshot = readMapSnapshot(snapshot_path, streets_path, map_streets_database_filename);
+        });
+
+        if (!from_snapshot){
+            // Set the projection first, every conversion to xy in the phases below depends on it
+            runLoadPhase("Map bounds", loadMapBounds);
+
+            // Size the per-element tables up front so phases can fill them by index
+            int num_intersections = getNumIntersections();
+            int num_segments = getNumStreetSegments();
+            int num_streets = getNumStreets();
+            intersection_data.resize(num_intersections); 
+            street_lengths.resize(num_streets);
+            street_travel_time.resize(num_segments);
+            segment_intersections.resize(num_segments);
+            POI_data.resize(getNumPointsOfInterest()); 
         }
 
-        // auto const cp2 = std::chrono::high_resolution_clock::now();
-        // auto const delta = std::chrono::duration_cast<std::chrono::milliseconds>(cp2 - cp1);
-        // std::cout << "OSM load took " << delta.count() << " ms" << std::endl;
-
-        // Preload various iteration bounds
-        int num_intersections = getNumIntersections();
-        int num_segments = getNumStreetSegments();
-        int num_streets = getNumStreets();
-        int num_nodes = getNumberOfNodes();
-        int num_ways = getNumberOfWays();
-        int num_poi = getNumPointsOfInterest();
-        
-        // Load vectors for multiple functions related to street segment
-        intersection_street_segments.resize(num_intersections); 
-        street_segments_of_street.resize(num_streets); 
-        intersection_data.resize(num_intersections); 
-        street_lengths.resize(num_streets);
-        POI_data.resize(num_poi); 
-        double length = 0;
-
-        // Find avg_lat for m2 function
-        max_lat = getIntersectionPosition(0).latitude(); 
-        min_lat = max_lat;
-        max_lon = getIntersectionPosition(0).longitude(); 
-        min_lon = max_lon;
-        
-        for (int i = 0; i < num_intersections; i++){
-            LatLon inter_pos = getIntersectionPosition(i);
-            
-            // Compare every lat/lon of intersection w initial to find max/min
-            max_lat = std::max(max_lat, inter_pos.latitude());
-            min_lat = std::min(min_lat, inter_pos.latitude());
-            max_lon = std::max(max_lon, inter_pos.longitude());
-            min_lon = std::min(min_lon, inter_pos.longitude());
+        // Phases below only depend on what is listed next to them, so each chain runs 
+        // as its own task. Loops inside a phase are split across the same thread team 
+        // with taskloop, so idle threads pick up chunks of whichever phase is still running
+        #pragma omp parallel
+        #pragma omp single
+        {
+            // OSM database -> OSM nodes -> OSM ways, unless the caller asked for
+            // the OSM layer later (see loadOSMLayer)
+            #pragma omp task shared(load_OSM, map_streets_database_filename)
+            if (osmBinStringChange && !defer_OSM_layer){
+                load_OSM = loadOSMPhases(map_streets_database_filename, from_snapshot);
+            }
+
+            if (!from_snapshot){
+                // Segments refer to intersections by id, so the two phases run independently
+                #pragma omp task
+                runLoadPhase("Intersections", loadIntersectionData);
+
+                // Segment geometry -> street segments -> street crossings
+                // Note: travel times and street lengths use the segment lengths
+                #pragma omp task
+                {
+                    runLoadPhase("Segment geometry", loadSegmentGeometry);
+                    runLoadPhase("Street segments", loadStreetSegmentData);
+                    runLoadPhase("Street crossings", loadStreetCrossings);
+                }
+
+                #pragma omp task
+                runLoadPhase("POIs", loadPOIData);
+
+                #pragma omp task
+                runLoadPhase("Features", loadFeatureData);
+
+                #pragma omp task
+                runLoadPhase("Street names", loadStreetNames);
+            }
         }
-    
-        avg_lat = ((min_lat + max_lat)/2);
-
-        // auto const cp3 = std::chrono::high_resolution_clock::now();
-        // auto delta2 = std::chrono::duration_cast<std::chrono::milliseconds>(cp3 - cp2);
-        // std::cout << "Inits took " << delta2.count() << " ms" << std::endl;
-
-        // Load intersection data
-        // Note: the following loop cannot be merged with the one after street segments loop
-        // Street segments loop needs this loop done first, but the one after that needs
-        // The street segments loop done first
-        for (IntersectionIdx i = 0; i < num_intersections; i++){
-            intersection_data[i].name = getIntersectionName(i);
-            LatLon inter_pos = getIntersectionPosition(i);
-            intersection_data[i].pos.x = x_from_lon(inter_pos.longitude());
-            intersection_data[i].pos.y = y_from_lat(inter_pos.latitude());
-        }   
-
-        // auto const cp4 = std::chrono::high_resolution_clock::now();
-        // auto delta3 = std::chrono::duration_cast<std::chrono::milliseconds>(cp4 - cp3);
-        // std::cout << "Intersections 1 took " << delta3.count() << " ms" << std::endl;
-
-        // Load various Street Segment related data structures
-        segment_intersections.resize(num_segments);
-        street_intersections.resize(num_streets);
-        point_data intersection_to, intersection_from;
-
-        for (StreetSegmentIdx i = 0; i < num_segments; i++){
-            StreetSegmentInfo street_info = getStreetSegmentInfo(i);
-            
-            //Intersections of street segment
-            intersection_street_segments[street_info.to].push_back(i);
-            intersection_street_segments[street_info.from].push_back(i);
-
-            // Travel time
-            length = findStreetSegmentLength(i);
-            street_travel_time.push_back(length/street_info.speedLimit);
-
-            // Street length
-            street_lengths[street_info.streetID] += length;
-
-            // Street segments of street
-            street_segments_of_street[street_info.streetID].push_back(i);
-
-            // Intersection xy coordinates
-            intersection_to = intersection_data[street_info.to];
-            intersection_from = intersection_data[street_info.from];
-
-            segment_intersections[i] = std::make_pair(intersection_from, intersection_to);    
-           
-            street_intersections[street_info.streetID].push_back(street_info.to);
-            street_intersections[street_info.streetID].push_back(street_info.from);
-        } 
-
-        for (int i = 0; i < street_intersections.size(); i++){
-            std::sort(street_intersections[i].begin(), street_intersections[i].end());
-            street_intersections[i].erase(std::unique(street_intersections[i].begin(), street_intersections[i].end()), street_intersections[i].end());
-        }   
-
-        // auto const cp5 = std::chrono::high_resolution_clock::now();
-        // auto delta4 = std::chrono::duration_cast<std::chrono::milliseconds>(cp5 - cp4);
-        // std::cout << "Segments took " << delta4.count() << " ms" << std::endl;
-
-        // Load POI info
-        for (POIIdx i = 0; i < num_poi; i++){
-            LatLon POI_pos = getPOIPosition(i);
-            POI_data[i].pos.x = x_from_lon(POI_pos.longitude());
-            POI_data[i].pos.y = y_from_lat(POI_pos.latitude());
-            POI_data[i].name = getPOIName(i);
+
+        // A cancelled load is missing phases
+        if (load_progress.cancel){
+            load_OSM = false;
+        }
+
+        // Only cache a complete load
+        if (!from_snapshot && load_OSM){
+            runLoadPhase("Snapshot write", [&](){
+                writeMapSnapshot(snapshot_path, streets_path, map_streets_database_filename);
+            });
         }
 
-        // auto const cp7 = std::chrono::high_resolution_clock::now();
-        // auto delta6 = std::chrono::duration_cast<std::chrono::milliseconds>(cp7 - cp5);
-        // std::cout << "POIs took " << delta6.count() << " ms" << std::endl;
-
-        // Load feature data
-        for (int i = 0; i < getNumFeatures(); i++){
-            std::vector<ezgl::point2d> feature_points;
-            double area = findFeatureArea(i);
-            int num_points = getNumFeaturePoints(i);
-            
-            feature_points.resize(num_points);
-
-            for (int j = 0; j < num_points; j++){
-                feature_points[j].x = x_from_lon(getFeaturePoint(j, i).longitude());
-                feature_points[j].y = y_from_lat(getFeaturePoint(j, i).latitude()); 
+        // After the snapshot write, which saves whichever form the geometry is in
+        if (compress_geometry || !segment_geometry.packed.empty() || !feature_geometry.packed.empty()){
+            runLoadPhase("Geometry blocks", loadGeometryBlocks);
+        }
+
+        if (load_OSM){
+            loaded_map_path = streets_path;
+            OSM_layer_loaded = true;
+        }
+        else if (osmBinStringChange && defer_OSM_layer && !load_progress.cancel){
+            loaded_map_path = streets_path;
+            deferred_OSM_layer.streets_path = streets_path;
+            deferred_OSM_layer.osm_path = map_streets_database_filename;
+            deferred_OSM_layer.snapshot_path = snapshot_path;
+            deferred_OSM_layer.from_snapshot = from_snapshot;
+            OSM_deferred = true;
+        }
+    }
+
+    auto const load_end = std::chrono::high_resolution_clock::now();
+    load_phase_times.push_back(std::make_pair(std::string("Total"), std::chrono::duration<double, std::milli>(load_end - load_start).count()));
+
+    std::cout << "loadMap: " << map_streets_database_filename << std::endl;
+
+    return load_successful && (load_OSM || OSM_deferred);
+}
+
+// Second stage of a loadMap call made with defer_OSM_layer set: opens the
+// OSM database, builds the OSM tag indexes and writes the map snapshot.
+// Only touches the OSM structures, so the map can be drawn meanwhile as long
+// as nothing reads them before OSM_layer_loaded is set
+bool loadOSMLayer(){
+    TRACE_SCOPE("loadOSMLayer");
+    if (deferred_OSM_layer.streets_path != loaded_map_path){
+        return false;
+    }
+
+    bool load_OSM = false;
+    #pragma omp parallel
+    #pragma omp single
+    load_OSM = loadOSMPhases(deferred_OSM_layer.osm_path, deferred_OSM_layer.from_snapshot);
+
+    if (load_progress.cancel){
+        load_OSM = false;
+    }
+    if (!deferred_OSM_layer.from_snapshot && load_OSM){
+        runLoadPhase("Snapshot write", [&](){
+            writeMapSnapshot(deferred_OSM_layer.snapshot_path, deferred_OSM_layer.streets_path, deferred_OSM_layer.osm_path);
+        });
+    }
+    deferred_OSM_layer = deferred_OSM_layer_load();
+    OSM_layer_loaded = load_OSM;
+    return load_OSM;
+}
+
+// Opens the OSM database of a map switchMap brought back without it
+bool openOSMDatabase(){
+    if (closed_OSM_database.empty()){
+        return true;
+    }
+    if (!loadOSMDatabaseBIN(closed_OSM_database)){
+        return false;
+    }
+    closed_OSM_database.clear();
+    return true;
+}
+
+// ------------- loadMap Phases -------------
+
+// Runs one loadMap phase and records how long it took in load_phase_times
+// and load_progress. Once the load is cancelled the remaining phases are skipped
+template <typename Phase>
+void runLoadPhase(const char* name, Phase phase){
+    if (load_progress.cancel){
+        return;
+    }
+    TRACE_SCOPE(name);
+    auto const start = std::chrono::high_resolution_clock::now();
+    phase();
+    auto const end = std::chrono::high_resolution_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    #pragma omp critical(load_phase_times)
+    load_phase_times.push_back(std::make_pair(std::string(name), ms));
+    load_progress.last_phase = name;
+    load_progress.phases_done++;
+}
+
+// Prints the per-phase timing breakdown of the last loadMap call
+// Phases that ran concurrently overlap, so they add up to more than the total
+void printLoadPhaseTimes(std::ostream& out){
+    for (auto const& phase : load_phase_times){
+        out << "  " << phase.first << ": " << phase.second << " ms" << std::endl;
+    }
+}
+
+// Memory report lines for the structures loadMap builds
+void addMapMemoryUsage(std::vector<memory_usage>& report){
+    report.push_back(measureMemory("intersection_street_segments", intersection_street_segments.values.size(), intersection_street_segments));
+    report.push_back(measureMemory("street_name_index", street_name_index.street_ids.size(), street_name_index));
+    report.push_back(measureMemory("street_fuzzy_names", street_fuzzy_names.gram_keys.size(), street_fuzzy_names));
+    report.push_back(measureMemory("street_name_pool", street_name_pool.size(), street_name_pool));
+    report.push_back(measureMemory("street_name_ids", street_name_ids.size(), street_name_ids));
+    report.push_back(measureMemory("OSM_node_index", OSM_node_index.ids.size(), OSM_node_index));
+    report.push_back(measureMemory("OSM_node_tags", OSM_node_tags.tags.size(), OSM_node_tags));
+    report.push_back(measureMemory("OSM_way_tags", OSM_way_tags.tags.size(), OSM_way_tags));
+    report.push_back(measureMemory("OSM_way_index", OSM_way_index.ids.size(), OSM_way_index));
+    report.push_back(measureMemory("OSM_way_length", OSM_way_length.size(), OSM_way_length));
+    report.push_back(measureMemory("street_travel_time", street_travel_time.size(), street_travel_time));
+    report.push_back(measureMemory("street_lengths", street_lengths.size(), street_lengths));
+    report.push_back(measureMemory("street_intersections", street_intersections.values.size(), street_intersections));
+    report.push_back(measureMemory("street_crossings", street_crossings.entry_keys.size(), street_crossings));
+    report.push_back(measureMemory("intersection_data", intersection_data.x.size(), intersection_data));
+    report.push_back(measureMemory("intersection_tree", intersection_tree.ids.size(), intersection_tree));
+    report.push_back(measureMemory("POI_data", POI_data.x.size(), POI_data));
+    report.push_back(measureMemory("POI_name_index", POI_name_index.pois.size(), POI_name_index));
+    report.push_back(measureMemory("segment_intersections", segment_intersections.size(), segment_intersections));
+    report.push_back(measureMemory("segment_geometry", segment_geometry.polylines.values.size(), segment_geometry));
+    report.push_back(measureMemory("street_segments_of_street", street_segments_of_street.values.size(), street_segments_of_street));
+    report.push_back(measureMemory("feature_geometry", feature_geometry.xs.size(), feature_geometry));
+    report.push_back(measureMemory("load_phase_times", load_phase_times.size(), load_phase_times));
+    // Not heap, but resident once touched, and what the structures above view
+    memory_usage snapshot_usage;
+    snapshot_usage.name = "map_snapshot (mapped)";
+    if (map_snapshot){
+        snapshot_usage.bytes = map_snapshot -> bytes;
+        snapshot_usage.allocations = 1;
+    }
+    report.push_back(snapshot_usage);
+}
+
+// Finds the lat/lon bounds of the map and sets the xy projection from them
+void loadMapBounds(){
+    int num_intersections = getNumIntersections();
+
+    max_lat = getIntersectionPosition(0).latitude(); 
+    min_lat = max_lat;
+    max_lon = getIntersectionPosition(0).longitude(); 
+    min_lon = max_lon;
+    
+    for (int i = 0; i < num_intersections; i++){
+        LatLon inter_pos = getIntersectionPosition(i);
+        
+        // Compare every lat/lon of intersection w initial to find max/min
+        max_lat = std::max(max_lat, inter_pos.latitude());
+        min_lat = std::min(min_lat, inter_pos.latitude());
+        max_lon = std::max(max_lon, inter_pos.longitude());
+        min_lon = std::min(min_lon, inter_pos.longitude());
+    }
+
+    projection = map_projection(min_lat, max_lat, min_lon, max_lon);
+}
+
+// Load intersection names and xy coordinates
+void loadIntersectionData(){
+    int num_intersections = getNumIntersections();
+
+    std::vector<std::string> names(num_intersections);
+    std::vector<LatLon> positions(num_intersections);
+
+    #pragma omp taskloop shared(names, positions)
+    for (IntersectionIdx i = 0; i < num_intersections; i++){
+        names[i] = getIntersectionName(i);
+        positions[i] = getIntersectionPosition(i);
+    }   
+    projection.storeXY(positions.data(), num_intersections, intersection_data.x.data(), intersection_data.y.data());
+
+    // The name pool isn't thread safe, so names are interned in order afterwards
+    for (IntersectionIdx i = 0; i < num_intersections; i++){
+        intersection_data.name_ids[i] = intersection_data.names.intern(names[i]);
+    }
+    intersection_tree.build(positions);
+}
+
+// Walk the curve points of every segment once, for its polyline, length and end bearings
+void loadSegmentGeometry(){
+    int num_segments = getNumStreetSegments();
+    segment_geometry.lengths.resize(num_segments);
+    segment_geometry.from_bearings.resize(num_segments);
+    segment_geometry.to_bearings.resize(num_segments);
+
+    // Both intersections plus the curve points
+    segment_geometry.polylines.beginCount(num_segments);
+    for (StreetSegmentIdx i = 0; i < num_segments; i++){
+        segment_geometry.polylines.count(i, getStreetSegmentInfo(i).numCurvePoints + 2);
+    }
+    segment_geometry.polylines.endCount();
+
+    // Each segment only fills its own row, so chunk them across cores
+    #pragma omp taskloop
+    for (StreetSegmentIdx i = 0; i < num_segments; i++){
+        StreetSegmentInfo segment_info = getStreetSegmentInfo(i);
+        int num_curve_points = segment_info.numCurvePoints;
+        LatLon intersection_1 = getIntersectionPosition(segment_info.from);
+        LatLon intersection_2 = getIntersectionPosition(segment_info.to);
+
+        segment_geometry.polylines.push(i, projection.store(intersection_1));
+        LatLon first_curve_point = intersection_2;
+        LatLon last_curve_point = intersection_1;
+        double curve_length = 0;
+        for (int c = 0; c < num_curve_points; c++){
+            LatLon point = getStreetSegmentCurvePoint(c, i);
+            segment_geometry.polylines.push(i, projection.store(point));
+            if (c == 0){
+                first_curve_point = point;
+            }
+            else{
+                curve_length += findDistanceBetweenTwoPoints(last_curve_point, point);
             }
+            last_curve_point = point;
+        }
+        segment_geometry.polylines.push(i, projection.store(intersection_2));
 
-            feature_data.push_back(std::make_pair(area, feature_points));
+        // Same sums, in the same order, as findStreetSegmentLength used to do
+        if (num_curve_points > 0){
+            double start_curve = findDistanceBetweenTwoPoints(intersection_1, first_curve_point);
+            double end_curve = findDistanceBetweenTwoPoints(last_curve_point, intersection_2);
+            segment_geometry.lengths[i] = curve_length + start_curve + end_curve;
+        }
+        else{
+            segment_geometry.lengths[i] = findDistanceBetweenTwoPoints(intersection_1, intersection_2);
         }
+        segment_geometry.from_bearings[i] = localBearing(intersection_1, first_curve_point);
+        segment_geometry.to_bearings[i] = localBearing(intersection_2, last_curve_point);
+    }
+
+    segment_geometry.polylines.endPush();
+}
+
+// Load various Street Segment related data structures
+void loadStreetSegmentData(){
+    int num_segments = getNumStreetSegments();
+    mapped_vector<double>& segment_lengths = segment_geometry.lengths;
+
+    // Per segment values don't depend on each other, so chunk them across cores
+    #pragma omp taskloop shared(segment_lengths)
+    for (StreetSegmentIdx i = 0; i < num_segments; i++){
+        StreetSegmentInfo street_info = getStreetSegmentInfo(i);
+
+        // Travel time
+        street_travel_time[i] = segment_lengths[i]/street_info.speedLimit;
+
+        // Intersections at either end
+        segment_intersections[i] = std::make_pair(street_info.from, street_info.to);
+    }
+
+    // Group segments by intersection and street in segment order, so the 
+    // result (and the street length sums) match a serial load exactly.
+    // One pass counts the size of every row, the second fills them in place
+    int num_intersections = getNumIntersections();
+    int num_streets = getNumStreets();
+    intersection_street_segments.beginCount(num_intersections);
+    street_segments_of_street.beginCount(num_streets);
+    street_intersections.beginCount(num_streets);
+    for (StreetSegmentIdx i = 0; i < num_segments; i++){
+        StreetSegmentInfo street_info = getStreetSegmentInfo(i);
+        intersection_street_segments.count(street_info.to);
+        intersection_street_segments.count(street_info.from);
+        street_segments_of_street.count(street_info.streetID);
+        street_intersections.count(street_info.streetID);
+        street_intersections.count(street_info.streetID);
+    }
+    intersection_street_segments.endCount();
+    street_segments_of_street.endCount();
+    street_intersections.endCount();
+
+    for (StreetSegmentIdx i = 0; i < num_segments; i++){
+        StreetSegmentInfo street_info = getStreetSegmentInfo(i);
+        
+        //Intersections of street segment
+        intersection_street_segments.push(street_info.to, i);
+        intersection_street_segments.push(street_info.from, i);
+
+        // Street length
+        street_lengths[street_info.streetID] += segment_lengths[i];
+
+        // Street segments of street
+        street_segments_of_street.push(street_info.streetID, i);
+
+        street_intersections.push(street_info.streetID, street_info.to);
+        street_intersections.push(street_info.streetID, street_info.from);
+    } 
+    intersection_street_segments.endPush();
+    street_segments_of_street.endPush();
+    street_intersections.endPush();
+
+    street_intersections.sortUniqueRows();
+}
+
+// Index every pair of streets that meet at an intersection
+void loadStreetCrossings(){
+    // Same rows as intersection_street_segments, with each segment replaced by its street
+    csr_table<StreetIdx> streets_of_intersection;
+    streets_of_intersection.offsets = intersection_street_segments.offsets;
+    streets_of_intersection.values.resize(intersection_street_segments.values.size());
+    int num_values = streets_of_intersection.values.size();
+
+    #pragma omp taskloop shared(streets_of_intersection)
+    for (int i = 0; i < num_values; i++){
+        streets_of_intersection.values[i] = getStreetSegmentInfo(intersection_street_segments.values[i]).streetID;
+    }
+
+    street_crossings.build(streets_of_intersection, getNumStreets());
+}
+
+// Load POI info
+void loadPOIData(){
+    int num_poi = getNumPointsOfInterest();
 
-        // auto const cp8 = std::chrono::high_resolution_clock::now();
-        // auto delta7 = std::chrono::duration_cast<std::chrono::milliseconds>(cp8 - cp7);
-        // std::cout << "Features took " << delta7.count() << " ms" << std::endl;
+    std::vector<std::string> names(num_poi);
+    std::vector<LatLon> positions(num_poi);
 
-        // Loading data structure street_names to use with partial street name func
-        for (char c = 97; c < 123; c++){
-            std::multimap<std::string, StreetIdx> letter;
-            street_names.insert(std::make_pair(c, letter));
+    #pragma omp taskloop shared(names, positions)
+    for (POIIdx i = 0; i < num_poi; i++){
+        positions[i] = getPOIPosition(i);
+        names[i] = getPOIName(i);
+    }
+    projection.storeXY(positions.data(), num_poi, POI_data.x.data(), POI_data.y.data());
+
+    std::vector<std::string_view> name_views(num_poi);
+    for (POIIdx i = 0; i < num_poi; i++){
+        POI_data.name_ids[i] = POI_data.names.intern(names[i]);
+        name_views[i] = POI_data.name(i);
+    }
+    POI_name_index.build(name_views, positions);
+}
+
+// Load feature data
+void loadFeatureData(){
+    int num_features = getNumFeatures();
+    feature_geometry.offsets.assign(num_features + 1, 0);
+    for (int i = 0; i < num_features; i++){
+        feature_geometry.offsets[i + 1] = feature_geometry.offsets[i] + getNumFeaturePoints(i);
+    }
+    feature_geometry.xs.resize(feature_geometry.offsets.back());
+    feature_geometry.ys.resize(feature_geometry.offsets.back());
+    feature_geometry.areas.assign(num_features, 0);
+    feature_geometry.min_xs.assign(num_features, 0);
+    feature_geometry.min_ys.assign(num_features, 0);
+    feature_geometry.max_xs.assign(num_features, 0);
+    feature_geometry.max_ys.assign(num_features, 0);
+    feature_geometry.closed.assign(num_features, false);
+
+    // One pass per feature that reads each vertex from the database once,
+    // then the area and bounds kernels run over the flat arrays
+    #pragma omp taskloop
+    for (int i = 0; i < num_features; i++){
+        int num_points = feature_geometry.numPoints(i);
+        if (num_points == 0){
+            continue;
         }
-        for (StreetIdx i = 0; i < num_streets; i++){
-            //Turn street name string to lowercase w no spaces
-            std::string currStreet = toLowerRemoveSpace(getStreetName(i));
-            //Insert in alphabetical categorization
-            char c = currStreet[0];
-            street_names[c].insert(std::make_pair(currStreet, i));
+        geometry_coord* stored_xs = feature_geometry.xs.data() + feature_geometry.offsets[i];
+        geometry_coord* stored_ys = feature_geometry.ys.data() + feature_geometry.offsets[i];
+        // Projected xy for outlineBounds, latitudes/longitudes in radians and
+        // the half latitude cos/sin for outlineArea
+        std::vector<double> xs(num_points), ys(num_points);
+        std::vector<double> lon(num_points), lat(num_points), half_cos(num_points), half_sin(num_points);
+
+        for (int j = 0; j < num_points; j++){
+            LatLon point = getFeaturePoint(j, i);
+            xs[j] = projection.x(point.longitude());
+            ys[j] = projection.y(point.latitude());
+            stored_xs[j] = projection.storeX(xs[j]);
+            stored_ys[j] = projection.storeY(ys[j]);
+            lon[j] = kDegreeToRadian*point.longitude();
+            lat[j] = kDegreeToRadian*point.latitude();
+            half_cos[j] = cos(lat[j]/2);
+            half_sin[j] = sin(lat[j]/2);
         }
 
-        // auto const cp9 = std::chrono::high_resolution_clock::now();
-        // auto delta8 = std::chrono::duration_cast<std::chrono::milliseconds>(cp9 - cp8);
-        // std::cout << "St names took " << delta8.count() << " ms" << std::endl;
-
-        // Load data structures OSM_node_ID, OSM_node_tags and OSM_way_ID for use with OSM related functions
-        const OSMNode *node_insert = NULL;
-        std::unordered_map<std::string, std::string> tag_map;
-        for (int i = 0; i < num_nodes; i++){
-            node_insert = getNodeByIndex(i);
-            if (node_insert != NULL){
-                OSMID id = node_insert -> id();
-                OSM_node_ID.insert(std::make_pair(id, node_insert));
-                OSM_node_tags.insert(std::make_pair(id, tag_map));
-                for(int j = 0; j < getTagCount(node_insert); j++){
-                    std::pair tag = getTagPair(node_insert, j);
-                    OSM_node_tags[id].insert(tag);
-                }
-            }
+        feature_geometry.closed[i] = getFeaturePoint(0, i) == getFeaturePoint(num_points - 1, i);
+        if (feature_geometry.closed[i]){
+            feature_geometry.areas[i] = outlineArea(lon.data(), lat.data(), half_cos.data(), half_sin.data(), num_points);
         }
+        outlineBounds(xs.data(), ys.data(), num_points, feature_geometry.min_xs[i], feature_geometry.min_ys[i], feature_geometry.max_xs[i], feature_geometry.max_ys[i]);
+    }
+}
+
+// Packs the segment and feature geometry into compressed blocks if
+// compress_geometry is set, and unpacks geometry a snapshot had packed otherwise
+void loadGeometryBlocks(){
+    if (compress_geometry){
+        segment_geometry.pack();
+        feature_geometry.pack();
+    }
+    else{
+        segment_geometry.unpack();
+        feature_geometry.unpack();
+    }
+}
 
-        const OSMWay *way_insert = NULL;
-        for (int i = 0; i < num_ways; i++){
-            length = 0;
-            way_insert = getWayByIndex(i);
-            if (way_insert != NULL){
-                OSM_way_ID.insert(std::make_pair(way_insert -> id(), way_insert));
-                std::vector<OSMID> way_members = getWayMembers(way_insert);
+// Loading data structure street_name_index to use with partial street name func
+void loadStreetNames(){
+    std::vector<std::pair<std::string, StreetIdx>> normalized_names(getNumStreets());
+    street_name_ids.resize(getNumStreets());
+    for (StreetIdx i = 0; i < getNumStreets(); i++){
+        std::string name = getStreetName(i);
+        street_name_ids[i] = street_name_pool.intern(name);
 
-                for (int j = 1; j < way_members.size(); j++){
-                    auto node1 = OSM_node_ID[way_members[j-1]];
-                    auto node2 = OSM_node_ID[way_members[j]];
+        //Turn street name string to lowercase w no spaces
+        normalized_names[i] = std::make_pair(toLowerRemoveSpace(name), i);
+    }
+    street_name_index.build(normalized_names);
+    street_fuzzy_names.build(street_name_index);
+}
+
+// OSM database -> OSM nodes -> OSM ways
+// The database is still loaded on a snapshot hit, other callers use the OSM API directly
+bool loadOSMPhases(const std::string& osm_path, bool from_snapshot){
+    // Loads osm database for use of osm header file functions, like return nodes, ways,etc
+    bool load_OSM = false;
+    runLoadPhase("OSM database", [&](){
+        load_OSM = loadOSMDatabaseBIN(osm_path);
+    });
+    if (load_OSM && !from_snapshot){
+        runLoadPhase("OSM nodes", loadOSMNodes);
+        runLoadPhase("OSM ways", loadOSMWays);
+    }
+    return load_OSM;
+}
+
+// Load data structures OSM_node_index and OSM_node_tags for use with OSM related functions
+void loadOSMNodes(){
+    int num_nodes = getNumberOfNodes();
+    std::vector<std::pair<uint64_t, uint32_t>> node_entries;
+    node_entries.reserve(num_nodes);
+
+    const OSMNode *node_insert = NULL;
+    for (int i = 0; i < num_nodes; i++){
+        node_insert = getNodeByIndex(i);
+        if (node_insert != NULL){
+            OSMID id = node_insert -> id();
+            node_entries.push_back(std::make_pair(static_cast<uint64_t>(id), uint32_t(i)));
+
+            // Most nodes are bare way members, only nodes with retained tags get a slot in the tag store
+            if (addProjectedTags(OSM_node_tags, node_insert)){
+                OSM_tag_report.nodes_kept++;
+            }
+            else{
+                OSM_tag_report.nodes_dropped++;
+            }
+        }
+    }
+
+    OSM_node_index.build(node_entries);
+    OSM_node_tags.finishObjects();
+}
 
-                    LatLon p1 = getNodeCoords(node1);
-                    LatLon p2 = getNodeCoords(node2);
+// Load data structures OSM_way_index, OSM_way_tags and OSM_way_length
+// Needs OSM_node_index to look up the coordinates of way members, and frees it when done
+void loadOSMWays(){
+    int num_ways = getNumberOfWays();
+    std::vector<double> way_lengths(num_ways, 0);
+
+    // Way lengths only read OSM_node_index, so they can be summed in parallel
+    #pragma omp taskloop shared(way_lengths)
+    for (int i = 0; i < num_ways; i++){
+        const OSMWay *way = getWayByIndex(i);
+        if (way != NULL){
+            std::vector<OSMID> way_members = getWayMembers(way);
+            std::vector<uint32_t> member_positions;
+            OSM_node_index.findBatch(way_members, member_positions);
+            double length = 0;
+
+            for (int j = 1; j < way_members.size(); j++){
+                if (member_positions[j-1] != NO_OSM_POSITION && member_positions[j] != NO_OSM_POSITION){
+                    LatLon p1 = getNodeCoords(getNodeByIndex(OSM_node_index.value(member_positions[j-1])));
+                    LatLon p2 = getNodeCoords(getNodeByIndex(OSM_node_index.value(member_positions[j])));
                     length += findDistanceBetweenTwoPoints(p1, p2);
                 }
+            }
 
-                if (isClosedWay(way_insert)){
-                    auto node1 = OSM_node_ID[way_members[0]];
-                    auto node2 = OSM_node_ID[way_members[way_members.size() - 1]];
+            if (isClosedWay(way)){
+                uint32_t first = member_positions[0];
+                uint32_t last = member_positions[way_members.size() - 1];
 
-                    LatLon p1 = getNodeCoords(node1);
-                    LatLon p2 = getNodeCoords(node2);
+                if (first != NO_OSM_POSITION && last != NO_OSM_POSITION){
+                    LatLon p1 = getNodeCoords(getNodeByIndex(OSM_node_index.value(first)));
+                    LatLon p2 = getNodeCoords(getNodeByIndex(OSM_node_index.value(last)));
                     length += findDistanceBetweenTwoPoints(p1, p2);
                 }
+            }
 
-                OSM_way_tags.insert(std::make_pair(way_insert -> id(), tag_map));
-                for(int j = 0; j < getTagCount(way_insert); j++){
-                    std::pair tag = getTagPair(way_insert, j);
-                    OSM_way_tags[way_insert -> id()].insert(tag);
-                }
+            way_lengths[i] = length;
+        }
+    }
+    OSM_node_index.clear();
+
+    std::vector<std::pair<uint64_t, uint32_t>> way_entries;
+    way_entries.reserve(num_ways);
+    const OSMWay *way_insert = NULL;
+    for (int i = 0; i < num_ways; i++){
+        way_insert = getWayByIndex(i);
+        if (way_insert != NULL){
+            way_entries.push_back(std::make_pair(static_cast<uint64_t>(way_insert -> id()), uint32_t(i)));
+
+            if (addProjectedTags(OSM_way_tags, way_insert)){
+                OSM_tag_report.ways_kept++;
+            }
+            else{
+                OSM_tag_report.ways_dropped++;
             }
-            OSM_way_length.insert(std::make_pair(way_insert -> id(), length));
         }
+    }
 
-        // auto const cp10 = std::chrono::high_resolution_clock::now();
-        // auto delta9 = std::chrono::duration_cast<std::chrono::milliseconds>(cp10 - cp9);
-        // std::cout << "OSM data took " << delta9.count() << " ms" << std::endl;
+    OSM_way_index.build(way_entries);
+    OSM_way_tags.finishObjects();
+
+    // Lengths move into index order so a lookup is one search plus one array read
+    OSM_way_length.resize(OSM_way_index.size());
+    for (size_t i = 0; i < OSM_way_index.size(); i++){
+        OSM_way_length[i] = way_lengths[OSM_way_index.value(i)];
     }
+}
 
-    std::cout << "loadMap: " << map_streets_database_filename << std::endl;
+// Adds the tags of an OSM node or way that pass OSM_tag_projection to store
+// The object only gets a slot if at least one of its tags is kept
+// Returns whether it got one
+template <typename Entity>
+bool addProjectedTags(osm_tag_store& store, const Entity* entity){
+    bool added = false;
+    int num_tags = getTagCount(entity);
+    for (int i = 0; i < num_tags; i++){
+        std::pair tag = getTagPair(entity, i);
+        if (OSM_tag_projection.keeps(tag.first, tag.second)){
+            if (!added){
+                store.beginObject(entity -> id());
+                added = true;
+            }
+            store.addTag(tag.first, tag.second);
+            OSM_tag_report.tags_kept++;
+        }
+        else{
+            OSM_tag_report.tags_dropped++;
+        }
+    }
+    return added;
+}
 
-    return load_successful && load_OSM;
+// Prints how many OSM nodes, ways and tags the tag projection kept during the last loadMap
+void printTagProjectionReport(std::ostream& out){
+    printTagProjectionReport(out, OSM_tag_report);
 }
 
 /* no dynamic memory allocation in m1.cpp, but api functions will deal with 
 dynam array atd: vector, hence just closing the apis */
 void closeMap() {
+    clearMapCache();
+    closeCurrentMap();
+    // UI state, left out of closeCurrentMap since that also runs on the map
+    // loader thread (checkMapLoad resets these when a new map is swapped in)
+    POI_on.clear();
+    nav_segments.clear();
+}
+
+// closeMap without freeing the maps parked by switchMap
+void closeCurrentMap() {
+    loaded_map_path.clear();
+    OSM_layer_loaded = false;
+    closed_OSM_database.clear();
     closeStreetDatabase(); 
     closeOSMDatabase();
     // Clear data structure to avoid duplicates
     intersection_street_segments.clear(); 
-    street_names.clear();
-    OSM_node_ID.clear();
+    street_name_index.clear();
+    street_fuzzy_names.clear();
+    street_name_pool.clear();
+    street_name_ids.clear();
+    OSM_node_index.clear();
     OSM_node_tags.clear();
     OSM_way_tags.clear();
+    OSM_way_index.clear();
     OSM_way_length.clear();
-    OSM_way_ID.clear();
     street_travel_time.clear();
     street_lengths.clear();
     street_intersections.clear();
+    street_crossings.clear();
     intersection_data.clear();
+    intersection_tree.clear();
     POI_data.clear();
+    POI_name_index.clear();
     segment_intersections.clear();
+    segment_geometry.clear();
     street_segments_of_street.clear();
-    POI_on.clear();
-    nav_segments.clear();
-    feature_data.clear();
+    feature_geometry.clear();
+    // Last, once nothing points into it. Frees the string pools of the map in
+    // a few chunks instead of a node per string
+    map_memory.reset();
+    map_snapshot.reset();
+}
+
+void swapMapState(map_state& state){
+    std::swap(map_memory, state.arena);
+    std::swap(map_snapshot, state.snapshot);
+    std::swap(projection, state.projection);
+    std::swap(max_lat, state.max_lat);
+    std::swap(min_lat, state.min_lat);
+    std::swap(max_lon, state.max_lon);
+    std::swap(min_lon, state.min_lon);
+    std::swap(intersection_street_segments, state.intersection_street_segments);
+    std::swap(street_name_index, state.street_name_index);
+    std::swap(street_fuzzy_names, state.street_fuzzy_names);
+    std::swap(street_name_pool, state.street_name_pool);
+    std::swap(street_name_ids, state.street_name_ids);
+    std::swap(OSM_node_tags, state.OSM_node_tags);
+    std::swap(OSM_way_tags, state.OSM_way_tags);
+    std::swap(OSM_way_index, state.OSM_way_index);
+    std::swap(OSM_way_length, state.OSM_way_length);
+    std::swap(OSM_tag_report, state.OSM_tag_report);
+    std::swap(street_travel_time, state.street_travel_time);
+    std::swap(street_lengths, state.street_lengths);
+    std::swap(street_intersections, state.street_intersections);
+    std::swap(street_crossings, state.street_crossings);
+    std::swap(intersection_data, state.intersection_data);
+    std::swap(intersection_tree, state.intersection_tree);
+    std::swap(POI_data, state.POI_data);
+    std::swap(POI_name_index, state.POI_name_index);
+    std::swap(segment_intersections, state.segment_intersections);
+    std::swap(segment_geometry, state.segment_geometry);
+    std::swap(street_segments_of_street, state.street_segments_of_street);
+    std::swap(feature_geometry, state.feature_geometry);
+    state.OSM_layer_loaded = OSM_layer_loaded.exchange(state.OSM_layer_loaded);
 }
 
 // Returns all intersections along the given street.
 // There should be no duplicate intersections in the returned vector.
 // Speed Requirement --> high
 std::vector<IntersectionIdx> findIntersectionsOfStreet(StreetIdx street_id){
+    array_view<IntersectionIdx> intersections = street_intersections[street_id];
+    return std::vector<IntersectionIdx>(intersections.begin(), intersections.end());
+}
+
+// Same as findIntersectionsOfStreet, without the copy
+array_view<IntersectionIdx> intersectionsOfStreet(StreetIdx street_id){
     return street_intersections[street_id];
 }
 
@@ -323,46 +868,41 @@ std::vector<IntersectionIdx> findIntersectionsOfStreet(StreetIdx street_id){
 // Speed Requirement --> high
 std::vector<IntersectionIdx> findIntersectionsOfTwoStreets(std::pair<StreetIdx, StreetIdx> street_ids){
     std::vector<IntersectionIdx> common_intersections;
-    std::vector<IntersectionIdx> st_one = findIntersectionsOfStreet(street_ids.first);
-    std::vector<IntersectionIdx> st_two = findIntersectionsOfStreet(street_ids.second);
-    for (int i = 0; i < st_one.size(); i++){
-        auto found = std::find(st_two.begin(), st_two.end(), st_one[i]);
-        if (found != st_two.end()){
-            common_intersections.push_back(st_one[i]);
-        }
-    }
+    intersectionsOfTwoStreets(street_ids, common_intersections);
     return common_intersections;
 }
 
+// Same as findIntersectionsOfTwoStreets, but fills common_intersections so
+// callers can reuse its storage across calls
+void intersectionsOfTwoStreets(std::pair<StreetIdx, StreetIdx> street_ids, std::vector<IntersectionIdx>& common_intersections){
+    common_intersections.clear();
+    // A street "crosses" itself at every one of its intersections
+    if (street_ids.first == street_ids.second){
+        array_view<IntersectionIdx> street = intersectionsOfStreet(street_ids.first);
+        common_intersections.assign(street.begin(), street.end());
+        return;
+    }
+    array_view<IntersectionIdx> crossing = street_crossings.find(street_ids.first, street_ids.second);
+    common_intersections.assign(crossing.begin(), crossing.end());
+}
+
+// Every crossing between a street of streets1 and a different street of streets2,
+// e.g. all the intersections of two street name prefixes, in streets1 order
+std::vector<street_crossing> findAllStreetCrossings(array_view<StreetIdx> streets1, array_view<StreetIdx> streets2){
+    return street_crossings.findAll(streets1, streets2);
+}
+
 // Returns the nearest point of interest of the given name (e.g. "Starbucks")
 // to the given position.
 // Speed Requirement --> none 
 POIIdx findClosestPOI(LatLon my_position, std::string poi_name){
-//findDistanceBetweenTwoPoints(LatLon point_1, LatLon point_2)
-// traverse through poi's
-
-    double distance=-1;
-    //pos 0 initial
-    POIIdx fcPOI=0; 
-  
-    for (POIIdx p=0; p<getNumPointsOfInterest(); p++){
-        
-        //if poi has this name, check for position      
-        if (poi_name.compare(getPOIName(p))==0){
-            
-            if (distance==-1){
-            distance=findDistanceBetweenTwoPoints(my_position,getPOIPosition(p)); 
-            fcPOI=p;
-            }
-            //fcPOI=100;
-            if((findDistanceBetweenTwoPoints(my_position, getPOIPosition(p)))<distance){
-            distance=findDistanceBetweenTwoPoints(my_position, getPOIPosition(p));
-            fcPOI=p;
-            }
-        }
+    // Only the KD-tree of POIs with this name is searched
+    POIIdx fcPOI = POI_name_index.closest(my_position, poi_name);
+    // No POI has this name, keep the old behaviour of returning POI 0
+    if (fcPOI < 0){
+        fcPOI = 0;
     }
-   return fcPOI;  
-
+    return fcPOI;
 }
 
 // Returns the length of the given street in meters.
@@ -394,7 +934,12 @@ double findDistanceBetweenTwoPoints(LatLon point_1, LatLon point_2){
 // Returns the street segments that connect to the given intersection.
 // Speed Requirement --> high
 std::vector<StreetSegmentIdx> findStreetSegmentsOfIntersection(IntersectionIdx intersection_id){
-    // Intersection not found in the map, return an empty vector or handle accordingly
+    array_view<StreetSegmentIdx> segments = intersection_street_segments[intersection_id];
+    return std::vector<StreetSegmentIdx>(segments.begin(), segments.end());
+}
+
+// Same as findStreetSegmentsOfIntersection, without the copy
+array_view<StreetSegmentIdx> streetSegmentsOfIntersection(IntersectionIdx intersection_id){
     return intersection_street_segments[intersection_id];
 }
 
@@ -428,56 +973,26 @@ bool intersectionsAreDirectlyConnected(std::pair<IntersectionIdx, IntersectionId
 // the given position.
 // Speed Requirement --> none
 IntersectionIdx findClosestIntersection(LatLon my_position){
+    // KD-tree lookup, same result as checking every intersection
+    return intersection_tree.nearest(my_position);
+}
 
-    double shortest_distance = findDistanceBetweenTwoPoints(my_position, getIntersectionPosition(0));
-    IntersectionIdx closestintersection = 0;
-    
-    // looping through intersections and updating shortest distance as new closest intersection 
-    for (int intersection = 0; intersection < getNumIntersections(); ++intersection) { // loop of each intersection
-            double checkdistance = findDistanceBetweenTwoPoints(my_position,getIntersectionPosition(intersection));
-            if (checkdistance < shortest_distance){
-                shortest_distance = checkdistance;
-                closestintersection = intersection;
-            }
-        }   
-    return closestintersection;
-  
+// Returns the k intersections closest to the given position, closest first
+std::vector<IntersectionIdx> findClosestIntersections(LatLon my_position, size_t k){
+    return intersection_tree.kNearest(my_position, k);
+}
+
+// Returns all intersections within radius meters of the given position, closest first
+std::vector<IntersectionIdx> findIntersectionsWithinRadius(LatLon my_position, double radius){
+    return intersection_tree.withinRadius(my_position, radius);
 }
 
 // Returns the length of the given street segment in meters.
 // Speed Requirement --> moderate
 
 double findStreetSegmentLength(StreetSegmentIdx street_segment_id){
-   StreetSegmentInfo segment_info = getStreetSegmentInfo(street_segment_id);
-   int num_curve_points = segment_info.numCurvePoints;
-   double curve_length = 0, street_segment_length = 0, start_curve, end_curve;
-   
-   LatLon intersection_1 = getIntersectionPosition(segment_info.from);
-   LatLon intersection_2 = getIntersectionPosition(segment_info.to);
-   
-   // calculating length of a street segment with curve points
-   if(num_curve_points > 0){
-        LatLon first_curve_point = getStreetSegmentCurvePoint(0, street_segment_id);
-        LatLon last_curve_point = getStreetSegmentCurvePoint(num_curve_points - 1, street_segment_id);
-        
-        for (int i = 0; i < num_curve_points - 1; i++) {
-            LatLon p1 = getStreetSegmentCurvePoint(i, street_segment_id);
-            LatLon p2 = getStreetSegmentCurvePoint(i + 1, street_segment_id);
-
-            curve_length += findDistanceBetweenTwoPoints(p1, p2);
-        }
-      
-        start_curve = findDistanceBetweenTwoPoints(intersection_1, first_curve_point);
-        end_curve = findDistanceBetweenTwoPoints(last_curve_point, intersection_2);
-
-        street_segment_length = curve_length + start_curve + end_curve;
-   }
-   else{
-       // calculating length of a street segment without curve points
-       street_segment_length = findDistanceBetweenTwoPoints(intersection_1, intersection_2);
-   }
-   
-   return street_segment_length;
+    // Summed over the curve points in loadMap
+    return segment_geometry.lengths[street_segment_id];
 }
 
 
@@ -496,90 +1011,35 @@ double findAngleBetweenStreetSegments(StreetSegmentIdx src_street_segment_id, St
     StreetSegmentInfo st_One = getStreetSegmentInfo(src_street_segment_id);
     StreetSegmentInfo st_Two = getStreetSegmentInfo(dst_street_segment_id);
 
-    LatLon p1;
-    LatLon p2;
-    LatLon p3;
-
-    // Determine the intersection point and the two non intersection points. convert to latlon points
+    // Determine the shared intersection, and the direction each segment leaves it in
+    double bearing_one, bearing_two;
 
     if (st_One.to == st_Two.to){
-        p1 = getIntersectionPosition(st_One.to);
-            if (st_One.numCurvePoints > 0){
-                p2 = getStreetSegmentCurvePoint(st_One.numCurvePoints - 1, src_street_segment_id);
-            }
-            else{
-                p2 = getIntersectionPosition(st_One.from);
-            }
-            if (st_Two.numCurvePoints > 0){
-                p3 = getStreetSegmentCurvePoint(st_Two.numCurvePoints - 1, dst_street_segment_id);
-            }
-            else{
-                p3 = getIntersectionPosition(st_Two.from);
-            }
+        bearing_one = segment_geometry.to_bearings[src_street_segment_id];
+        bearing_two = segment_geometry.to_bearings[dst_street_segment_id];
     }
-    
-    
     else if (st_One.to == st_Two.from){
-        p1 = getIntersectionPosition(st_One.to);
-            if (st_One.numCurvePoints > 0){
-                p2 = getStreetSegmentCurvePoint(st_One.numCurvePoints - 1, src_street_segment_id);
-            }
-            else{
-                p2 = getIntersectionPosition(st_One.from);
-            }
-            if (st_Two.numCurvePoints > 0){
-                p3 = getStreetSegmentCurvePoint(0, dst_street_segment_id);
-            }
-            else{
-                p3 = getIntersectionPosition(st_Two.to);
-            }
+        bearing_one = segment_geometry.to_bearings[src_street_segment_id];
+        bearing_two = segment_geometry.from_bearings[dst_street_segment_id];
     }
-    
-    
     else if (st_One.from == st_Two.to){
-        p1 = getIntersectionPosition(st_One.from);
-            if (st_One.numCurvePoints > 0){
-                p2 = getStreetSegmentCurvePoint(0, src_street_segment_id);
-            }
-            else{
-                p2 = getIntersectionPosition(st_One.to);
-            }
-            if (st_Two.numCurvePoints > 0){
-                p3 = getStreetSegmentCurvePoint(st_Two.numCurvePoints - 1, dst_street_segment_id);
-            }
-            else{
-                p3 = getIntersectionPosition(st_Two.from);;
-            }
+        bearing_one = segment_geometry.from_bearings[src_street_segment_id];
+        bearing_two = segment_geometry.to_bearings[dst_street_segment_id];
     }
-    
-    
     else if (st_One.from == st_Two.from){
-        p1 = getIntersectionPosition(st_One.from);
-        if (st_One.numCurvePoints > 0){
-            p2 = getStreetSegmentCurvePoint(0, src_street_segment_id);
-            }
-            else{
-                p2 = getIntersectionPosition(st_One.to);
-            }
-            if (st_Two.numCurvePoints > 0){
-                p3 = getStreetSegmentCurvePoint(0, dst_street_segment_id);
-            }
-            else{
-                p3 = getIntersectionPosition(st_Two.to);
-            }
+        bearing_one = segment_geometry.from_bearings[src_street_segment_id];
+        bearing_two = segment_geometry.from_bearings[dst_street_segment_id];
     }
-    
     else{
         return NO_ANGLE;
     }
 
-    // Convert to lengths a, b, and c
-    double a = findDistanceBetweenTwoPoints(p1, p2);
-    double b = findDistanceBetweenTwoPoints(p1, p3);
-    double c = findDistanceBetweenTwoPoints(p2, p3);
-
-    // Use cosine law to find angle
-    return 3.141592 - cosLaw(a, b, c);
+    // Angle between the two pieces at the intersection, in [0, pi]
+    double between = std::fabs(bearing_one - bearing_two);
+    if (between > M_PI){
+        between = 2*M_PI - between;
+    }
+    return 3.141592 - between;
 }
 
 double findStreetSegmentTravelTime(StreetSegmentIdx street_segment_id){
@@ -600,27 +1060,26 @@ double findStreetSegmentTravelTime(StreetSegmentIdx street_segment_id){
 // Speed Requirement --> high
 
 std::vector<StreetIdx> findStreetIdsFromPartialStreetName(std::string street_prefix){
-    std::vector<StreetIdx> streetMatch;
-    if (street_prefix.size() <= 0){
-        return streetMatch;
-    }
-    //Turn prefix to lowercase w no spaces
-    std::string prefix = toLowerRemoveSpace(street_prefix);
-    char c = prefix[0];
-
-    // Starts at first prefix match using lower_bound
-    for (auto it = street_names[c].lower_bound(prefix); it != street_names[c].end(); it++){
-        //Compare the two strings
-        std::size_t found = it -> first.find(prefix);
-        if (found != 0){
-            break;
-        }
-        else{
-            streetMatch.push_back(it -> second);
-        }
-    }
+    array_view<StreetIdx> matches = streetIdsFromPartialStreetName(street_prefix, 0, SIZE_MAX);
     //Return vector
-    return streetMatch;
+    return std::vector<StreetIdx>(matches.begin(), matches.end());
+}
+
+// Same as findStreetIdsFromPartialStreetName, but returns a view of the matches
+// Only up to limit matches are returned, starting from the offset-th one, so 
+// huge prefixes can be paged through
+array_view<StreetIdx> streetIdsFromPartialStreetName(std::string_view street_prefix, size_t offset, size_t limit){
+    //Turn prefix to lowercase w no spaces
+    std::string prefix = toLowerRemoveSpace(std::string(street_prefix));
+    return street_name_index.findPage(prefix, offset, limit);
+}
+
+// Typo tolerant version of findStreetIdsFromPartialStreetName
+// Returns up to max_results streets whose name starts within MAX_FUZZY_DISTANCE 
+// edits of street_prefix, closest first
+std::vector<fuzzy_street_match> findFuzzyStreetMatches(std::string_view street_prefix, size_t max_results){
+    std::string prefix = toLowerRemoveSpace(std::string(street_prefix));
+    return street_fuzzy_names.fuzzyFind(street_name_index, prefix, max_results, FUZZY_BUDGET_US);
 }
 
 
@@ -630,30 +1089,8 @@ std::vector<StreetIdx> findStreetIdsFromPartialStreetName(std::string street_pre
 // Speed Requirement --> moderate
 
 double findFeatureArea(FeatureIdx feature_id){
-    int total_points = getNumFeaturePoints(feature_id);
-    double total_area = 0;
-
-    // Not a closed polygon
-    if (!(getFeaturePoint(0, feature_id) == getFeaturePoint(total_points - 1, feature_id))){
-        return 0;
-    }
-    // Else program will continue
-    for (int i = 0; i < total_points - 1; i++){
-        LatLon p1 = getFeaturePoint(i, feature_id);
-        LatLon p2 = getFeaturePoint(i + 1, feature_id);
-
-        double lat_Avg = (p1.latitude() + p2.latitude())/2;
-        double x1 = kEarthRadiusInMeters * kDegreeToRadian * p1.longitude() * cos(kDegreeToRadian*lat_Avg); 
-        double x2 = kEarthRadiusInMeters * kDegreeToRadian * p2.longitude() * cos(kDegreeToRadian*lat_Avg); 
-
-        double y1 = kEarthRadiusInMeters * kDegreeToRadian * p1.latitude(); 
-        double y2 = kEarthRadiusInMeters * kDegreeToRadian * p2.latitude();
-
-        double temp_area = (x1 + x2)*(y2 - y1)/2;
-        total_area += temp_area;
-    }
-
-    return abs(total_area);
+    // Areas are precomputed in loadMap (loadFeatureData)
+    return feature_geometry.areas[feature_id];
 }
 
 // Returns the length of the OSMWay that has the given OSMID, in meters.
@@ -662,15 +1099,11 @@ double findFeatureArea(FeatureIdx feature_id){
 // Speed Requirement --> high
 
 double findWayLength(OSMID way_id){
-    // Find the OSMWay corresponding to the given ID
+    // Way lengths are precomputed in loadMap, ways that don't exist have no entry
     double length = 0;
-    auto it = OSM_way_ID.find(way_id);
-    if (it != OSM_way_ID.end()){
-        std::vector<OSMID> way_members = getWayMembers(it -> second);
-        auto it2 = OSM_way_length.find(way_id);
-        if (it2 != OSM_way_length.end()){
-            length = it2 -> second;
-        }
+    uint32_t position = OSM_way_index.find(way_id);
+    if (position != NO_OSM_POSITION){
+        length = OSM_way_length[position];
     }
     return length;
 }
@@ -681,41 +1114,38 @@ double findWayLength(OSMID way_id){
 // Speed Requirement --> high
 
 std::string getOSMNodeTagValue(OSMID osm_id, std::string key){
-    // Find the OSMNode corresponding to the given ID
-    std::string valueFound = "";
-
-    auto it = OSM_node_tags.find(osm_id);
-    if (it != OSM_node_tags.end()){
-        auto tagmap = it -> second;
-        auto tagit = tagmap.find(key);
-        if (tagit != tagmap.end()){
-            valueFound = tagit -> second;
-        }
-    }
-    return valueFound;
+    return std::string(OSM_node_tags.getTagValue(osm_id, key));
+}
+
+// Same as getOSMNodeTagValue, but returns a view into the tag store
+// Valid until the map is closed
+std::string_view getOSMNodeTagView(OSMID osm_id, std::string_view key){
+    return OSM_node_tags.getTagValue(osm_id, key);
 }
 
 // ------------- Nusaiba's Helper Functions -------------
 
 // Get OSMWay tag value
-std::string getOSMWayTagValue(OSMID osm_id, std::string key){
-    // Find the OSMNode corresponding to the given ID
-    std::string valueFound = "";
-
-    auto it = OSM_way_tags.find(osm_id);
-    if (it != OSM_way_tags.end()){
-        auto tagmap = it -> second;
-        auto tagit = tagmap.find(key);
-        if (tagit != tagmap.end()){
-            valueFound = tagit -> second;
-        }
-    }
-    return valueFound;
+std::string getOSMWayTagValue(OSMID osm_id, std::string_view key){
+    return std::string(OSM_way_tags.getTagValue(osm_id, key));
+}
+
+// Get OSMWay tag value as a view into the tag store, valid until the map is closed
+std::string_view getOSMWayTagView(OSMID osm_id, std::string_view key){
+    return OSM_way_tags.getTagValue(osm_id, key);
+}
+
+// Get the name of a street as a view, valid until the map is closed
+std::string_view streetNameView(StreetIdx street_id){
+    return street_name_pool.get(street_name_ids[street_id]);
 }
 
 // Get the node by ID rather than index
 const OSMNode* getNodeByID(OSMID osm_id){
     const OSMNode *nodeSearch = NULL;
+    if (!openOSMDatabase()){
+        return nodeSearch;
+    }
     for (int i = 0; i < getNumberOfNodes(); i++){
         nodeSearch = getNodeByIndex(i);
         if (nodeSearch != NULL){
@@ -735,7 +1165,8 @@ std::string toLowerRemoveSpace(std::string input_string){
     while (input_string[i]){
         char myChar = input_string[i];
         if (myChar != ' '){
-            myChar = tolower(myChar);
+            // Through unsigned char, UTF-8 bytes of non-Latin names are left as they are
+            myChar = tolower((unsigned char) myChar);
             newString += myChar;
         }
         i += 1;
@@ -743,25 +1174,13 @@ std::string toLowerRemoveSpace(std::string input_string){
     return newString;
 }
 
-//Find an angle in radians given sides a, b, and c using Cosines law
-double cosLaw(double a, double b, double c){
-    double a2 = a*a;
-    double b2 = b*b;
-    double c2 = c*c;
-    double num = a2 + b2 - c2;
-    double denom = 2*a*b;
-    double expression = num/denom;
-    // Making sure acos doesn't recieve any invalid values due to rounding
-    if (expression > 1){
-        expression = 1;
-    }
-    if (expression < -1){
-        expression = -1;
-    }
-
-    double angle = acos(expression);
-
-    return angle;
+// Direction (radians, counter-clockwise from east) of the line from one
+// point to another, in the same local xy findDistanceBetweenTwoPoints uses
+double localBearing(LatLon from, LatLon to){
+    double lat_avg = (from.latitude() + to.latitude())/2;
+    double dx = kEarthRadiusInMeters * kDegreeToRadian * (to.longitude() - from.longitude()) * cos(kDegreeToRadian*lat_avg);
+    double dy = kEarthRadiusInMeters * kDegreeToRadian * (to.latitude() - from.latitude());
+    return atan2(dy, dx);
 }
 
 // Samiyah's Helper Functions
@@ -1,5 +1,17 @@
 
 #include "globals.h"
+#include "memory_report.h"
+#include "trace.h"
+#include "map_loader.h"
+
+// A visible street segment and the style drawStreets draws it in
+struct street_draw_item{
+    StreetSegmentIdx segment;
+    StreetSegmentInfo info;
+    std::string_view type;
+    std::string_view name;
+    bool one_way;
+};
 
 // Function declarations used in drawMap
 void draw_main_canvas(ezgl::renderer *g);
@@ -12,9 +24,11 @@ void drawStreets(ezgl::renderer*, double scale_factor);
 void drawIntersections(ezgl::renderer*);
 void drawPOIs(ezgl::renderer*);
 void drawStreetLines(ezgl::renderer*, int, StreetSegmentInfo);
-void setStreetStyle(ezgl::renderer*, std::string, std::string, double, bool);
+void drawStreetPass(ezgl::renderer*, const std::vector<street_draw_item>&, double);
+void setStreetStyle(ezgl::renderer*, std::string_view, std::string_view, double, bool);
 void drawStreetNames(ezgl::renderer * g, double scale_factor);
 double getSlope(StreetSegmentInfo);
+std::string_view streetSegmentType(const StreetSegmentInfo&);
 
 // UI Helper Functions
 void loadCss(const gchar*);
@@ -33,8 +47,15 @@ void enterSearch(GtkEntry*, ezgl::application*);
 void langChoice(GtkComboBox*, ezgl::application*);
 void poiToggle(GtkWidget*, GdkEventButton, gpointer, ezgl::application*);
 bool isVisible(ezgl::point2d, ezgl::renderer*);
+ezgl::point2d segmentMidpoint(StreetSegmentIdx);
+bool segmentIsVisible(StreetSegmentIdx, ezgl::renderer*);
 void submitNav(GtkButton*, ezgl::application*);
 void submitNav2(GtkButton*, ezgl::application*);
+std::vector<StreetIdx> findStreetsForInput(const gchar*);
+std::vector<IntersectionIdx> findIntersectionsOfInputs(const std::vector<StreetIdx>&, const std::vector<StreetIdx>&);
+bool mapReady(ezgl::application*);
+gboolean checkMapLoad(gpointer);
+gboolean checkOSMLayerLoad(gpointer);
 
 // M3 UI Helper Functions 
 void drawPath(std::vector<StreetSegmentIdx>, ezgl::renderer*, double);
@@ -54,7 +75,12 @@ int POI_prev = 0;
 int inter_last = 0;
 int num_POI_categories = 31;
 int num_directions = 0;
+// Most crossings listed by name in the Intersections menu
+const int MAX_LISTED_CROSSINGS = 20;
 IntersectionIdx inter_one, inter_two;
+// City picked in the Load Map menu, and whether checkMapLoad is polling its load
+std::string loading_map_name;
+bool map_load_timer = false;
 
 // UI related data structures
 std::vector<gboolean> POI_on;
@@ -87,12 +113,25 @@ void drawMap() {
     // Define canvas
     application.add_canvas("MainCanvas", draw_main_canvas, initial_world);
 
+    // Redraw with the POIs and road classes once the second loading stage is done
+    if (!OSM_layer_loaded){
+        g_timeout_add(100, checkOSMLayerLoad, &application);
+    }
+
     // Run the application until the user quits
     application.run(initial_setup, act_on_mouse_click, nullptr, nullptr);
+
+    // Don't leave a map load running behind closeMap
+    cancelMapLoad();
 }
 
 // Draws/renders the map features onto MainCanvas
 void draw_main_canvas(ezgl::renderer *g){
+    TRACE_SCOPE("draw_main_canvas");
+    // The map data belongs to the loader until the new map is ready
+    if (mapLoading() || loaded_map_path.empty()){
+        return;
+    }
 
     // Determine current scale for help with drawing 
     // map elements
@@ -135,12 +174,12 @@ void draw_main_canvas(ezgl::renderer *g){
         // If the first pin is being selected, draw it on top
         if (inter_first == false){
             if (inter_two != NO_DATA){
-                ezgl::point2d pos_two = intersection_data[inter_two].pos; 
+                ezgl::point2d pos_two = intersection_data.pos(inter_two); 
                 ezgl::surface* icon_two = g->load_png("libstreetmap/resources/directions/2.png");
                 g->draw_surface(icon_two, pos_two, 0.4);
             }
             if (inter_one != NO_DATA){
-                ezgl::point2d pos_one = intersection_data[inter_one].pos; 
+                ezgl::point2d pos_one = intersection_data.pos(inter_one); 
                 ezgl::surface* icon_one = g->load_png("libstreetmap/resources/directions/1.png");
                 g->draw_surface(icon_one, pos_one, 0.4);
             }
@@ -149,12 +188,12 @@ void draw_main_canvas(ezgl::renderer *g){
         // draw that on top instead
         else{
             if (inter_one != NO_DATA){
-                ezgl::point2d pos_one = intersection_data[inter_one].pos; 
+                ezgl::point2d pos_one = intersection_data.pos(inter_one); 
                 ezgl::surface* icon_one = g->load_png("libstreetmap/resources/directions/1.png");
                 g->draw_surface(icon_one, pos_one, 0.4);
             }
             // if (inter_two != NO_DATA){
-            //     ezgl::point2d pos_two = intersection_data[inter_two].pos; 
+            //     ezgl::point2d pos_two = intersection_data.pos(inter_two); 
             //     ezgl::surface* icon_two = g->load_png("libstreetmap/resources/directions/2.png");
             //     g->draw_surface(icon_two, pos_two, 0.4);
             // }
@@ -180,19 +219,38 @@ void refreshMap(ezgl::application* application) {
 // A helper function called in draw_main_canvas
 // Draws map features such as lakes, parks etc
 void drawFeatures(ezgl::renderer *g, double scale_factor){
-    for (int i = 0; i < getNumFeatures(); i++){
-        std::vector<ezgl::point2d> feature_vert = feature_data[i].second;
-        double area = feature_data[i].first;
-        bool show = false;
+    TRACE_SCOPE("drawFeatures");
+    ezgl::rectangle world = g -> get_visible_world();
+    // Reused for every feature drawn
+    std::vector<ezgl::point2d> feature_vert;
+    // Whether the current feature is big enough to show at this zoom
+    auto bigEnough = [&](int i){
+        double area = feature_geometry.areas[i];
+        return scale_factor < 0.15 || area > 10000 || (scale_factor < 0.25 && area > 200);
+    };
+
+    // Compressed outlines are decoded up front a block at a time rather than
+    // per feature, then drawn below in feature order. The drawn features are
+    // the ones the loop below fills, in the same order
+    bool packed = !feature_geometry.packed.empty();
+    std::vector<uint32_t> drawn;
+    std::vector<ezgl::point2d> drawn_points;
+    std::vector<uint32_t> drawn_firsts;
+    if (packed){
+        for (int i = 0; i < feature_geometry.size(); i++){
+            if (bigEnough(i) && feature_geometry.overlaps(i, world) && feature_geometry.numPoints(i) > 1 && feature_geometry.closed[i]){
+                drawn.push_back(i);
+            }
+        }
+        feature_geometry.packed.gather(drawn, drawn_points, drawn_firsts);
+    }
+    size_t next_drawn = 0;
 
+    for (int i = 0; i < feature_geometry.size(); i++){
         // Only draw the current feature if these conditions are met
-        if (scale_factor < 0.15 || area > 10000 || (scale_factor < 0.25 && area > 200)){
+        if (bigEnough(i)){
             // Determine whether any part of the feature is in visible range
-            for (int j = 0; j < feature_vert.size(); j++){
-                if (isVisible(feature_vert[j], g) == true){
-                    show = true;
-                }
-            }
+            bool show = feature_geometry.overlaps(i, world);
 
             // If visible, then print
             if (show == true){
@@ -280,10 +338,15 @@ void drawFeatures(ezgl::renderer *g, double scale_factor){
                 }
                 
                 // Draw the feature given its vertices
-                if(feature_vert.size() > 1){
-                    if ((feature_vert[0].x == feature_vert[getNumFeaturePoints(i)-1].x) && (feature_vert[0].y == feature_vert[getNumFeaturePoints(i)-1].y)){
-                        g->fill_poly(feature_vert);
+                if (feature_geometry.numPoints(i) > 1 && feature_geometry.closed[i]){
+                    if (packed){
+                        feature_vert.assign(drawn_points.begin() + drawn_firsts[next_drawn], drawn_points.begin() + drawn_firsts[next_drawn + 1]);
+                        next_drawn++;
+                    }
+                    else{
+                        feature_geometry.outline(i, feature_vert);
                     }
+                    g->fill_poly(feature_vert);
                 }
             }
         }
@@ -293,57 +356,72 @@ void drawFeatures(ezgl::renderer *g, double scale_factor){
 // A helper function called in draw_main_canvas
 // Uses other helper functions to draw streets
 void drawStreets(ezgl::renderer * g, double scale_factor) {
-    // Draw smaller streets first 
+    TRACE_SCOPE("drawStreets");
+    // Smaller streets are drawn first, larger streets on top in a different
+    // colour afterwards so that colours don't overlap in unwanted ways
+    // Visibility only reads the coordinate arrays, so check it before looking up the segment's tags
+    std::vector<street_draw_item> smaller, larger;
     for (StreetSegmentIdx i = 0; i < segment_intersections.size(); i++) {
+        if (!segmentIsVisible(i, g)){
+            continue;
+        }
         StreetSegmentInfo info = getStreetSegmentInfo(i);
-        std::string type = getOSMWayTagValue(info.wayOSMID, "highway");
-        std::string st_name = getStreetName(info.streetID);
-
-        if (scale_factor < 0.15 && (type == "tertiary" || type == "residential" || type == "unclassified" || st_name == "<unknown>" )) {
-            ezgl::point2d med;
-            //from + (to - from)/2
-            med.x = segment_intersections[i].first.pos.x + ((segment_intersections[i].second.pos.x - segment_intersections[i].first.pos.x) / 2);
-            med.y = segment_intersections[i].first.pos.y + ((segment_intersections[i].second.pos.y - segment_intersections[i].first.pos.y) / 2);
-            if (isVisible(segment_intersections[i].first.pos, g) || isVisible(segment_intersections[i].second.pos, g) || isVisible(med, g)){
-                setStreetStyle(g, type, st_name, scale_factor, info.oneWay);
-                drawStreetLines(g, i, info);
-            }
+        std::string_view type = streetSegmentType(info);
+        std::string_view st_name = streetNameView(info.streetID);
+
+        if (scale_factor < 0.15 && (type == "tertiary" || type == "residential" || type == "unclassified" || st_name == "<unknown>")) {
+            smaller.push_back(street_draw_item{i, info, type, st_name, info.oneWay});
+        }
+        else if ((type == "motorway" || type == "primary" || type == "secondary") && st_name != "<unknown>"){
+            larger.push_back(street_draw_item{i, info, type, st_name, false});
         }
     }
+    drawStreetPass(g, smaller, scale_factor);
+    drawStreetPass(g, larger, scale_factor);
+}
 
-    // Draw larger streets on top in a different colour
-    // Must be drawn afterwards in a separate loop
-    // So that colours don't overlap in unwanted ways
-    for (StreetSegmentIdx i = 0; i < segment_intersections.size(); i++) {
-        StreetSegmentInfo info = getStreetSegmentInfo(i);
-        std::string type = getOSMWayTagValue(info.wayOSMID, "highway");
-        std::string st_name = getStreetName(info.streetID);
-        if ((type == "motorway" || type == "primary" || type == "secondary") && st_name != "<unknown>"){
-            ezgl::point2d med;
-            med.x = segment_intersections[i].first.pos.x + ((segment_intersections[i].second.pos.x - segment_intersections[i].first.pos.x) / 2);
-            med.y = segment_intersections[i].first.pos.y + ((segment_intersections[i].second.pos.y - segment_intersections[i].first.pos.y) / 2);
-            if (isVisible(segment_intersections[i].first.pos, g) || isVisible(segment_intersections[i].second.pos, g) || isVisible(med, g)){
-                setStreetStyle(g, type, st_name, scale_factor, false);
-                drawStreetLines(g, i, info);
+// A helper function called in drawStreets
+// Draws segments in order, each in the style of its road class
+void drawStreetPass(ezgl::renderer * g, const std::vector<street_draw_item>& items, double scale_factor){
+    // Compressed polylines are decoded a block at a time rather than per segment
+    bool packed = !segment_geometry.packed.empty();
+    std::vector<ezgl::point2d> points;
+    std::vector<uint32_t> firsts;
+    if (packed){
+        std::vector<uint32_t> segments(items.size());
+        for (size_t k = 0; k < items.size(); k++){
+            segments[k] = items[k].segment;
+        }
+        segment_geometry.packed.gather(segments, points, firsts);
+    }
+
+    for (size_t k = 0; k < items.size(); k++){
+        setStreetStyle(g, items[k].type, items[k].name, scale_factor, items[k].one_way);
+        if (packed){
+            for (uint32_t p = firsts[k]; p + 1 < firsts[k + 1]; p++){
+                g -> draw_line(points[p], points[p + 1]);
             }
         }
+        else{
+            drawStreetLines(g, items[k].segment, items[k].info);
+        }
     }
 }
 
 // A helper function called in draw_main_canvas
 // Draws names of streets 
 void drawStreetNames(ezgl::renderer * g, double scale_factor){
+    TRACE_SCOPE("drawStreetNames");
     StreetSegmentInfo infoprev = getStreetSegmentInfo(getNumStreetSegments() - 1);
     for (StreetSegmentIdx i = 0; i < segment_intersections.size(); i++) {
         StreetSegmentInfo info = getStreetSegmentInfo(i);
 
         // Get the midpoint
-        ezgl::point2d med;
-        med.x = segment_intersections[i].first.pos.x + ((segment_intersections[i].second.pos.x - segment_intersections[i].first.pos.x) / 2);
-        med.y = segment_intersections[i].first.pos.y + ((segment_intersections[i].second.pos.y - segment_intersections[i].first.pos.y) / 2);
+        ezgl::point2d med = segmentMidpoint(i);
 
         if (scale_factor < 0.012 && isVisible(med, g) == true) {
-            if (getStreetName(info.streetID) != "<unknown>"  && getStreetName(infoprev.streetID)!= getStreetName(info.streetID)) {
+            std::string_view st_name = streetNameView(info.streetID);
+            if (st_name != "<unknown>"  && streetNameView(infoprev.streetID) != st_name) {
                 // Set the text colour
                 if (night){
                     g -> set_color(ezgl::WHITE);
@@ -364,7 +442,7 @@ void drawStreetNames(ezgl::renderer * g, double scale_factor){
                 g -> set_text_rotation(angle);
 
                 // Draw the name
-                g -> draw_text(med, getStreetName(info.streetID), strtLen, strtLen);
+                g -> draw_text(med, std::string(st_name), strtLen, strtLen);
                 
             }
         }
@@ -372,11 +450,27 @@ void drawStreetNames(ezgl::renderer * g, double scale_factor){
     }
 }
 
+// Helper function for drawing street segments
+// from + (to - from)/2, read from the intersection coordinate arrays
+ezgl::point2d segmentMidpoint(StreetSegmentIdx i){
+    ezgl::point2d from = intersection_data.pos(segment_intersections[i].first);
+    ezgl::point2d to = intersection_data.pos(segment_intersections[i].second);
+    return ezgl::point2d(from.x + (to.x - from.x)/2, from.y + (to.y - from.y)/2);
+}
+
+// Helper function for drawing street segments
+// True if either end or the midpoint of the segment is on screen
+bool segmentIsVisible(StreetSegmentIdx i, ezgl::renderer* g){
+    return isVisible(intersection_data.pos(segment_intersections[i].first), g)
+        || isVisible(intersection_data.pos(segment_intersections[i].second), g)
+        || isVisible(segmentMidpoint(i), g);
+}
+
 // Helper function for determining angle 
 // to print street names
 double getSlope(StreetSegmentInfo info){
-    ezgl::point2d from = intersection_data[info.from].pos;
-    ezgl::point2d to = intersection_data[info.to].pos;
+    ezgl::point2d from = intersection_data.pos(info.from);
+    ezgl::point2d to = intersection_data.pos(info.to);
     double rise = to.y - from.y;
     double run = to.x - from.x;
     return rise/run;
@@ -386,7 +480,7 @@ double getSlope(StreetSegmentInfo info){
 // Sets the line colour, width and other styles 
 // based on information given about the street
 // about to be drawn
-void setStreetStyle(ezgl::renderer * g, std::string type, std::string name, double scale_factor, bool one_way){
+void setStreetStyle(ezgl::renderer * g, std::string_view type, std::string_view name, double scale_factor, bool one_way){
     // Styles for smaller streets
     if (type == "tertiary" || type == "residential" || type == "unclassified" || name == "<unknown>" ){
         if (night){
@@ -459,56 +553,38 @@ void setStreetStyle(ezgl::renderer * g, std::string type, std::string name, doub
     }      
 }
 
+// A helper function called in drawStreets
+// Road class of a segment: its OSM highway tag, or until the OSM layer is
+// loaded a guess from the speed limit so the main roads show from the first frame
+std::string_view streetSegmentType(const StreetSegmentInfo& info){
+    if (OSM_layer_loaded){
+        return getOSMWayTagView(info.wayOSMID, "highway");
+    }
+    // Speed limits are in m/s
+    if (info.speedLimit >= 80/3.6){
+        return "motorway";
+    }
+    if (info.speedLimit >= 60/3.6){
+        return "secondary";
+    }
+    return "residential";
+}
+
 // A helper function called in drawStreets
 // Draws the actual lines and curves given the points
 // After styles have been set
-void drawStreetLines(ezgl::renderer * g, int i, StreetSegmentInfo info){
-    if (info.numCurvePoints > 0){
-        // If the segment has curve points
-        LatLon first_P = getStreetSegmentCurvePoint(0, i);
-        
-        // From first segment point to first curve point
-        g -> draw_line({
-        segment_intersections[i].first.pos.x,
-        segment_intersections[i].first.pos.y
-        }, {
-        x_from_lon(first_P.longitude()),
-        y_from_lat(first_P.latitude())
-        });
-
-        // Drawing curve points
-        for (int curvP = 0; curvP < info.numCurvePoints - 1; curvP++) {
-            LatLon currPoint = getStreetSegmentCurvePoint(curvP, i);
-            LatLon currPoint2 = getStreetSegmentCurvePoint(curvP + 1, i);
-            g -> draw_line({
-            x_from_lon(currPoint.longitude()),
-            y_from_lat(currPoint.latitude())
-            }, {
-            x_from_lon(currPoint2.longitude()),
-            y_from_lat(currPoint2.latitude())
-            });
+void drawStreetLines(ezgl::renderer * g, int i, StreetSegmentInfo /*info*/){
+    // From intersection, curve points, to intersection, already projected in loadMap
+    if (!segment_geometry.packed.empty()){
+        array_view<ezgl::point2d> points = segment_geometry.packed.points(i);
+        for (size_t p = 0; p + 1 < points.size(); p++){
+            g -> draw_line(points[p], points[p + 1]);
         }
-
-        LatLon lastPoint = getStreetSegmentCurvePoint(info.numCurvePoints - 1, i);
-
-        // From last curve point to last segment point
-        g -> draw_line({
-        x_from_lon(lastPoint.longitude()),
-        y_from_lat(lastPoint.latitude())
-        }, {
-        segment_intersections[i].second.pos.x,
-        segment_intersections[i].second.pos.y
-        });
+        return;
     }
-    else {
-        // If segment has no curve points
-        g -> draw_line({
-        segment_intersections[i].first.pos.x,
-        segment_intersections[i].first.pos.y
-        }, {
-        segment_intersections[i].second.pos.x,
-        segment_intersections[i].second.pos.y
-        });
+    array_view<geometry_point> points = segment_geometry.polylines[i];
+    for (size_t p = 0; p + 1 < points.size(); p++){
+        g -> draw_line(projection.load(points[p]), projection.load(points[p + 1]));
     }
 }
 
@@ -517,49 +593,76 @@ void drawStreetLines(ezgl::renderer * g, int i, StreetSegmentInfo info){
 // Highlight is set by clicking on map
 // Or using Intersections menu
 void drawIntersections(ezgl::renderer *g){
-    for (size_t i= 0; i < intersection_data.size();i++){
-        //only shows intersection when clicked, highlighted
-        if (intersection_data[i].highlight == true && isVisible(intersection_data[i].pos, g)){
-            ezgl::point2d inter_loc = intersection_data[i].pos; 
+    TRACE_SCOPE("drawIntersections");
+    //only shows intersection when clicked, highlighted
+    intersection_data.forEachHighlighted([&](size_t i){
+        if (isVisible(intersection_data.pos(i), g)){
+            ezgl::point2d inter_loc = intersection_data.pos(i); 
 
             ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/pin.png");
             g->draw_surface(icon, inter_loc, 0.4);
         }
-    }
+    });
+}
+
+// The only OSM tags the mapper reads (in drawPOIs, drawStreets and drawPath)
+// Set as OSM_tag_projection before loadMap so everything else is dropped at load time
+// Keep in sync when drawing starts reading a new tag
+osm_tag_projection mapperTagProjection(){
+    osm_tag_projection projection;
+    projection.keep_all = false;
+    projection.rules = {
+        {"highway", {}},
+        {"aeroway", {"aerodrome"}},
+        {"amenity", {"restaurant", "driving_school", "language_school", "library", "bank", "bureau_de_change",
+                     "clinic", "dentist", "hospital", "pharmacy", "community_centre", "place_of_worship", "refugee_site"}},
+        {"diet:*", {"yes"}},
+        {"community_centre:for", {"immigrant"}},
+        {"religion", {"christian", "hindu", "muslim", "sikh", "buddhist"}},
+        {"diplomatic", {"embassy", "consulate"}},
+        {"office", {"employment_agency", "government"}},
+        {"shop", {"supermarket"}}
+    };
+    return projection;
 }
 
 // A helper function called in draw_main_canvas
-// Draws icons & for Points of Interest when the 
+// Draws icons & for Points of Interest when the
 // corresponding category is set as active (in Layers menu)
 // Also draw POI pin if POI is highlighted
 void drawPOIs(ezgl::renderer *g){
+    TRACE_SCOPE("drawPOIs");
+    // POI categories come from the OSM tags, so they show up once the OSM layer is loaded
+    if (!OSM_layer_loaded){
+        return;
+    }
     float size_factor = 0.2; // Relative size of icon
     gboolean g_true = 1;
     
     for (POIIdx i = 0; i < POI_data.size(); i++){
-        ezgl::point2d POI_loc = POI_data[i].pos;
+        ezgl::point2d POI_loc = POI_data.pos(i);
 
         // Only draw the POI if in visible range
         if (isVisible(POI_loc, g) == true){
             // Determine icon based on POI type/categorization
 
             // aeroway: aerodrome
-            if (getOSMWayTagValue(getPOIOSMNodeID(i), "aeroway") == "aerodrome" && POI_on[29] == g_true){
+            if (getOSMWayTagView(getPOIOSMNodeID(i), "aeroway") == "aerodrome" && POI_on[29] == g_true){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/airport.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
         
             // amenity: restaurant, veg, halal
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") =="restaurant" ){
-                if (getOSMNodeTagValue(getPOIOSMNodeID(i), "diet:vegetarian") == "yes" && (POI_on[1] == g_true || POI_on[0] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") =="restaurant" ){
+                if (getOSMNodeTagView(getPOIOSMNodeID(i), "diet:vegetarian") == "yes" && (POI_on[1] == g_true || POI_on[0] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/vegetarian.png");
                 g->draw_surface(icon, POI_loc, size_factor);
                 }
-                else if(getOSMNodeTagValue(getPOIOSMNodeID(i), "diet:vegan") == "yes" && (POI_on[2] == g_true || POI_on[0] == g_true)){
+                else if(getOSMNodeTagView(getPOIOSMNodeID(i), "diet:vegan") == "yes" && (POI_on[2] == g_true || POI_on[0] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/vegan.png");
                 g->draw_surface(icon, POI_loc, size_factor);
                 }
-                else if(getOSMNodeTagValue(getPOIOSMNodeID(i), "diet:halal") == "yes" && (POI_on[3] == g_true || POI_on[0] == g_true)){
+                else if(getOSMNodeTagView(getPOIOSMNodeID(i), "diet:halal") == "yes" && (POI_on[3] == g_true || POI_on[0] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/halal.png");
                 g->draw_surface(icon, POI_loc, size_factor);
                 }
@@ -570,69 +673,69 @@ void drawPOIs(ezgl::renderer *g){
             }
             
             // amenity: driving school
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") =="driving_school" && (POI_on[5] == g_true || POI_on[4] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") =="driving_school" && (POI_on[5] == g_true || POI_on[4] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/driving.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
             
             // amenity: language school
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") == "language_school" && (POI_on[6] == g_true || POI_on[4] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") == "language_school" && (POI_on[6] == g_true || POI_on[4] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/language.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
             
             // amenity: library
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") == "library" && (POI_on[7] == g_true || POI_on[4] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") == "library" && (POI_on[7] == g_true || POI_on[4] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/library.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
             
             // amenity: bank
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") == "bank" && (POI_on[9] == g_true || POI_on[8] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") == "bank" && (POI_on[9] == g_true || POI_on[8] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/bank.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
             
             // amenity: bureau de change
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") == "bureau_de_change" && (POI_on[10] == g_true || POI_on[8] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") == "bureau_de_change" && (POI_on[10] == g_true || POI_on[8] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/exchange.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
             
             // amenity: clinic
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") == "clinic" && (POI_on[13] == g_true || POI_on[11] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") == "clinic" && (POI_on[13] == g_true || POI_on[11] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/clinic.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
             
             // amenity: dentist
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") == "dentist" && (POI_on[15] == g_true || POI_on[11] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") == "dentist" && (POI_on[15] == g_true || POI_on[11] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/dentist.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
             
             // amenity: hospital
-            if ((getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") == "hospital" || getOSMWayTagValue(getPOIOSMNodeID(i), "amenity") == "hospital") && (POI_on[12] == g_true || POI_on[11] == g_true)){
+            if ((getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") == "hospital" || getOSMWayTagView(getPOIOSMNodeID(i), "amenity") == "hospital") && (POI_on[12] == g_true || POI_on[11] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/hospital.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
                     
             // amenity: pharmacy
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") == "pharmacy" && (POI_on[14] == g_true || POI_on[11] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") == "pharmacy" && (POI_on[14] == g_true || POI_on[11] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/pharmacy.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
                     
             // amenity: community_centre
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") == "community_centre" && (POI_on[27] == g_true || POI_on[26] == g_true)){
-                if (getOSMNodeTagValue(getPOIOSMNodeID(i), "community_centre:for") == "immigrant"){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") == "community_centre" && (POI_on[27] == g_true || POI_on[26] == g_true)){
+                if (getOSMNodeTagView(getPOIOSMNodeID(i), "community_centre:for") == "immigrant"){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/community.png");
                 g->draw_surface(icon, POI_loc, size_factor);
                 }
             }
             
             // amenity: place_worship, religions
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") =="place_of_worship"){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") =="place_of_worship"){
                 g->set_color(ezgl::BLACK);
                 g->set_font_size(10);
                 ezgl::point2d Print_loc;
@@ -640,29 +743,29 @@ void drawPOIs(ezgl::renderer *g){
                 Print_loc.y= POI_loc.y - 3.5;
                 float strtLen= 100;
                 std:: string poiN = getPOIName(i);
-                if (getOSMNodeTagValue(getPOIOSMNodeID(i), "religion") =="christian" && (POI_on[18] == g_true || POI_on[16] == g_true)){
+                if (getOSMNodeTagView(getPOIOSMNodeID(i), "religion") =="christian" && (POI_on[18] == g_true || POI_on[16] == g_true)){
                     ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/church.png");
                     g->draw_surface(icon, POI_loc, size_factor);
                     g->draw_text (Print_loc, poiN, strtLen, strtLen);
                     g->set_color (200, 150, 255);
                 }
-                else if (getOSMNodeTagValue(getPOIOSMNodeID(i), "religion") =="hindu" && (POI_on[20] == g_true || POI_on[16] == g_true)){
+                else if (getOSMNodeTagView(getPOIOSMNodeID(i), "religion") =="hindu" && (POI_on[20] == g_true || POI_on[16] == g_true)){
                     ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/htemple.png");
                     g->draw_surface(icon, POI_loc, size_factor);
                     g->draw_text (Print_loc, poiN, strtLen, strtLen);
                     g->set_color (200, 150, 255);
                 }
-                else if (getOSMNodeTagValue(getPOIOSMNodeID(i), "religion") =="muslim" && (POI_on[17] == g_true || POI_on[16] == g_true)){
+                else if (getOSMNodeTagView(getPOIOSMNodeID(i), "religion") =="muslim" && (POI_on[17] == g_true || POI_on[16] == g_true)){
                     ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/mosque.png"); 
                     g->draw_surface(icon, POI_loc, size_factor);
                     g->draw_text (Print_loc, poiN, strtLen, strtLen);
                     g->set_color (200, 150, 255);
                 }       
-                else if (getOSMNodeTagValue(getPOIOSMNodeID(i), "religion") == "sikh" && (POI_on[21] == g_true || POI_on[16] == g_true)){
+                else if (getOSMNodeTagView(getPOIOSMNodeID(i), "religion") == "sikh" && (POI_on[21] == g_true || POI_on[16] == g_true)){
                     ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/synagogue.png");
                     g->draw_surface(icon, POI_loc, size_factor);
                 }           
-                else if (getOSMNodeTagValue(getPOIOSMNodeID(i), "religion") == "buddhist" && (POI_on[19] == g_true || POI_on[16] == g_true)){
+                else if (getOSMNodeTagView(getPOIOSMNodeID(i), "religion") == "buddhist" && (POI_on[19] == g_true || POI_on[16] == g_true)){
                     ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/btemple.png");
                     g->draw_surface(icon, POI_loc, size_factor);
                 }      
@@ -673,29 +776,29 @@ void drawPOIs(ezgl::renderer *g){
             }        
             
             // amenity: refugee_site
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "amenity") =="refugee_site" && (POI_on[30] == g_true || POI_on[26] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "amenity") =="refugee_site" && (POI_on[30] == g_true || POI_on[26] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/refugee.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }        
             
             
             // boundary: office, diplomatic, employment agency, government
-            if ((getOSMNodeTagValue(getPOIOSMNodeID(i), "diplomatic") == "embassy" || getOSMNodeTagValue(getPOIOSMNodeID(i), "diplomatic") == "consulate") && (POI_on[24] == g_true || POI_on[22] == g_true)){
+            if ((getOSMNodeTagView(getPOIOSMNodeID(i), "diplomatic") == "embassy" || getOSMNodeTagView(getPOIOSMNodeID(i), "diplomatic") == "consulate") && (POI_on[24] == g_true || POI_on[22] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/diplomatic.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "office") == "employment_agency" && (POI_on[25] == g_true || POI_on[22] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "office") == "employment_agency" && (POI_on[25] == g_true || POI_on[22] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/employment.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "office") == "government" && (POI_on[23] == g_true || POI_on[22] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "office") == "government" && (POI_on[23] == g_true || POI_on[22] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/government.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }                          
             
 
             // boundary: supermarket
-            if (getOSMNodeTagValue(getPOIOSMNodeID(i), "shop") =="supermarket" && (POI_on[28] == g_true || POI_on[26] == g_true)){
+            if (getOSMNodeTagView(getPOIOSMNodeID(i), "shop") =="supermarket" && (POI_on[28] == g_true || POI_on[26] == g_true)){
                 ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/supermarket.png");
                 g->draw_surface(icon, POI_loc, size_factor);
             }
@@ -705,14 +808,14 @@ void drawPOIs(ezgl::renderer *g){
     // Display POI pin if location is highlighted
     // Highlight is set by typing POI name into
     // the searchbar at top left
-    for (POIIdx i = 0; i < POI_data.size(); i++){
-        if (POI_data[i].highlight == true && isVisible(POI_data[i].pos, g) == true){
-            ezgl::point2d POI_loc = POI_data[i].pos;
+    POI_data.forEachHighlighted([&](size_t i){
+        if (isVisible(POI_data.pos(i), g) == true){
+            ezgl::point2d POI_loc = POI_data.pos(i);
             
             ezgl::surface* icon = g->load_png("libstreetmap/resources/poi/POI.png");
             g->draw_surface(icon, POI_loc, 0.4);
         }
-    }
+    });
 }
 
 // --------------------------- Helper Functions & Callback Functions ---------------------------
@@ -721,8 +824,11 @@ void drawPOIs(ezgl::renderer *g){
 // Sets navigation start/end points if navigation mode is on
 // Otherwise sets intersection highlight for pin to be drawn
 void act_on_mouse_click(ezgl::application* app, GdkEventButton* /*event*/, double x, double y){
-    intersection_data[inter_last].highlight = false;
-    POI_data[POI_prev].highlight = false;
+    if (!mapReady(app)){
+        return;
+    }
+    intersection_data.setHighlight(inter_last, false);
+    POI_data.setHighlight(POI_prev, false);
     LatLon pos = LatLon (lat_from_y(y), lon_from_x(x));
     
     int inter_id = findClosestIntersection(pos);
@@ -741,34 +847,34 @@ void act_on_mouse_click(ezgl::application* app, GdkEventButton* /*event*/, doubl
     }
     else{
         inter_last = inter_id;
-        intersection_data[inter_id].highlight = true;
+        intersection_data.setHighlight(inter_id, true);
         inter_one = -1;
         inter_two = -1;
     }
     std::stringstream ss;
-    ss<< "Intersection \""<< intersection_data[inter_id].name<< "\" at ("<< pos.latitude() <<","<<pos.longitude()<<")";
+    ss<< "Intersection \""<< intersection_data.name(inter_id)<< "\" at ("<< pos.latitude() <<","<<pos.longitude()<<")";
     app->update_message(ss.str());
     app->refresh_drawing(); // forces redraw so that highlight is updated immediatly and not after next drawCanvas when screen moved
 }
 
 // Converts longitude to cartesian x
-double x_from_lon (float lon){
-    return (lon * kDegreeToRadian * kEarthRadiusInMeters * std::cos(avg_lat*kDegreeToRadian));
+double x_from_lon (double lon){
+    return projection.x(lon);
 }
 
 // Converts latitude to cartesian y
-double y_from_lat (float lat){
-    return (lat* kDegreeToRadian*kEarthRadiusInMeters);
+double y_from_lat (double lat){
+    return projection.y(lat);
 }
 
 // Converts cartesian y to latitude
-double lat_from_y(float y){
-    return y / (kDegreeToRadian * kEarthRadiusInMeters);
+double lat_from_y(double y){
+    return projection.lat(y);
 }
 
 // Converts cartesian x to longitude
-double lon_from_x(float x){
-    return x / (kDegreeToRadian * kEarthRadiusInMeters * std::cos(avg_lat*kDegreeToRadian));
+double lon_from_x(double x){
+    return projection.lon(x);
 }
 
 // Initializes UI elements, connects signal callbacks, imports CSS styling
@@ -874,6 +980,9 @@ void navMenu(GtkButton* /*menu*/, ezgl::application* application){
 // Validates input when entering starting nav point
 // If valid, records input and opens menu for entering destination point
 void submitNav(GtkButton* /*submit*/, ezgl::application* application){
+    if (!mapReady(application)){
+        return;
+    }
     // Get entry widgets & label widget
     auto entry1 = application->find_widget("Inter1S1");
     auto entry2 = application->find_widget("Inter1S2");
@@ -897,15 +1006,14 @@ void submitNav(GtkButton* /*submit*/, ezgl::application* application){
         gtk_label_set_text(label, text);
     }
     else{
-        std::vector<IntersectionIdx> common_intersections;
-        std::vector<StreetIdx> streets1 = findStreetIdsFromPartialStreetName(st1);
-        std::vector<StreetIdx> streets2 = findStreetIdsFromPartialStreetName(st2);
+        std::vector<StreetIdx> streets1 = findStreetsForInput(st1);
+        std::vector<StreetIdx> streets2 = findStreetsForInput(st2);
 
         if (streets1.size() >= 1 && streets2.size() >= 1){
-            // Valid input
-            common_intersections = findIntersectionsOfTwoStreets(std::make_pair(streets1[0], streets2[0]));
-            if (common_intersections.size() >= 1){
-                inter_one = common_intersections[0];
+            // Valid input, take the first crossing in match order of any of the matching streets
+            std::vector<street_crossing> crossings = findAllStreetCrossings(streets1, streets2);
+            if (crossings.size() >= 1){
+                inter_one = crossings[0].intersections[0];
                 inter_first = true;
                 firstIntersection(application);
             }
@@ -922,7 +1030,6 @@ void submitNav(GtkButton* /*submit*/, ezgl::application* application){
             gtk_label_set_text(label, text);
         }
 
-        common_intersections.clear();
         streets1.clear();
         streets2.clear();
     }
@@ -933,6 +1040,9 @@ void submitNav(GtkButton* /*submit*/, ezgl::application* application){
 // Validates input when entering destination nav point
 // If valid, records input and opens menu with directions listed
 void submitNav2(GtkButton* /*submit*/, ezgl::application* application){
+    if (!mapReady(application)){
+        return;
+    }
     // Get entry widgets & label widget
     auto entry1 = application->find_widget("Inter2S1");
     auto entry2 = application->find_widget("Inter2S2");
@@ -956,15 +1066,14 @@ void submitNav2(GtkButton* /*submit*/, ezgl::application* application){
         gtk_label_set_text(label, text);
     }
     else{
-        std::vector<IntersectionIdx> common_intersections;
-        std::vector<StreetIdx> streets1 = findStreetIdsFromPartialStreetName(st1);
-        std::vector<StreetIdx> streets2 = findStreetIdsFromPartialStreetName(st2);
+        std::vector<StreetIdx> streets1 = findStreetsForInput(st1);
+        std::vector<StreetIdx> streets2 = findStreetsForInput(st2);
 
         if (streets1.size() >= 1 && streets2.size() >= 1){
-            // Valid input
-            common_intersections = findIntersectionsOfTwoStreets(std::make_pair(streets1[0], streets2[0]));
-            if (common_intersections.size() >= 1){
-                inter_two = common_intersections[0];
+            // Valid input, take the first crossing in match order of any of the matching streets
+            std::vector<street_crossing> crossings = findAllStreetCrossings(streets1, streets2);
+            if (crossings.size() >= 1){
+                inter_two = crossings[0].intersections[0];
                 inter_first = false;
                 secondIntersection(application);
             }
@@ -981,7 +1090,6 @@ void submitNav2(GtkButton* /*submit*/, ezgl::application* application){
             gtk_label_set_text(label, text);
         }
 
-        common_intersections.clear();
         streets1.clear();
         streets2.clear();
     }
@@ -1008,6 +1116,9 @@ void nightMode(GtkButton* /*menu*/, ezgl::application* application){
 // and records for use when drawing POI
 // icons on map
 void poiToggle(GtkWidget* self, GdkEventButton /*event*/, gpointer /*data*/, ezgl::application* application){
+    if (!mapReady(application)){
+        return;
+    }
     // Getting POI list bools
     GtkContainer* container = (GtkContainer*) self;
     GList* box_list = gtk_container_get_children(container);
@@ -1075,8 +1186,11 @@ void menuPopup(const gchar* layer, ezgl::application* application){
 
     if ((layer_check_2 == "Navigation" || layer_check_2 == "Navigation2" || layer_check_2 == "Directions") && gtk_widget_is_visible(menu)){
         nav = true;
-        intersection_data[inter_last].highlight = false;
-        POI_data[POI_prev].highlight = false;
+        // The stores may be mid rebuild while a map loads
+        if (mapReady(application)){
+            intersection_data.setHighlight(inter_last, false);
+            POI_data.setHighlight(POI_prev, false);
+        }
         if (layer_check_2 == "Directions" || layer_check_2 == "Navigation"){
             directions = true;
         }
@@ -1091,9 +1205,38 @@ void menuPopup(const gchar* layer, ezgl::application* application){
     application->refresh_drawing();
 }
 
+// Helper function for the Intersections and Navigation menus
+// Finds the streets matching a street name typed by the user
+// Falls back to a typo tolerant search if no street name starts with the input
+std::vector<StreetIdx> findStreetsForInput(const gchar* input){
+    std::vector<StreetIdx> streets = findStreetIdsFromPartialStreetName(input);
+    if (streets.empty()){
+        for (auto const& match : findFuzzyStreetMatches(input, 10)){
+            streets.push_back(match.street);
+        }
+    }
+    return streets;
+}
+
+// Helper function for Intersections menu
+// Returns every intersection where a street of streets1 crosses a street of
+// streets2, in increasing order, so all streets sharing a typed prefix are covered
+std::vector<IntersectionIdx> findIntersectionsOfInputs(const std::vector<StreetIdx>& streets1, const std::vector<StreetIdx>& streets2){
+    std::vector<IntersectionIdx> common_intersections;
+    for (auto const& crossing : findAllStreetCrossings(streets1, streets2)){
+        common_intersections.insert(common_intersections.end(), crossing.intersections.begin(), crossing.intersections.end());
+    }
+    std::sort(common_intersections.begin(), common_intersections.end());
+    common_intersections.erase(std::unique(common_intersections.begin(), common_intersections.end()), common_intersections.end());
+    return common_intersections;
+}
+
 // Helper function for Intersections menu
 // Validates input, and processes if valid
 void twoIntersections(GtkButton* /*button*/, ezgl::application* application){
+    if (!mapReady(application)){
+        return;
+    }
     // Get entry widgets & label widget
     auto entry1 = application->find_widget("Street1");
     auto entry2 = application->find_widget("Street2");
@@ -1116,24 +1259,31 @@ void twoIntersections(GtkButton* /*button*/, ezgl::application* application){
     }
     else{
         std::vector<IntersectionIdx> common_intersections;
-        std::vector<StreetIdx> streets1 = findStreetIdsFromPartialStreetName(st1);
-        std::vector<StreetIdx> streets2 = findStreetIdsFromPartialStreetName(st2);
+        std::vector<StreetIdx> streets1 = findStreetsForInput(st1);
+        std::vector<StreetIdx> streets2 = findStreetsForInput(st2);
 
         if (streets1.size() >= 1 && streets2.size() >= 1){
             // Valid input
-            POI_data[POI_prev].highlight = false;
-            intersection_data[inter_last].highlight=false;
-            common_intersections = findIntersectionsOfTwoStreets(std::make_pair(streets1[0], streets2[0]));
+            POI_data.setHighlight(POI_prev, false);
+            intersection_data.setHighlight(inter_last, false);
+            common_intersections = findIntersectionsOfInputs(streets1, streets2);
             msg = "Here are the intersections \nthese streets have in common:\n";
             
-            int end= common_intersections.size();
+            // Every crossing is highlighted, but only the first few fit in the label
+            int end = common_intersections.size();
         
             for (int i = 0; i < end; i++){
-                const gchar* name = intersection_data[common_intersections[i]].name.c_str();
-                intersection_data[common_intersections[i]].highlight = true;
+                const gchar* name = intersection_data.name(common_intersections[i]).data();
+                intersection_data.setHighlight(common_intersections[i], true);
                 inter_last = common_intersections[i];
             
-                msg = g_strconcat(msg, name, "\n", NULL);
+                if (i < MAX_LISTED_CROSSINGS){
+                    msg = g_strconcat(msg, name, "\n", NULL);
+                }
+            }
+            if (end > MAX_LISTED_CROSSINGS){
+                std::string more = "and " + std::to_string(end - MAX_LISTED_CROSSINGS) + " more\n";
+                msg = g_strconcat(msg, more.c_str(), NULL);
             }
         }
         else{
@@ -1159,74 +1309,145 @@ void changeMap(GtkComboBox* box, ezgl::application* application){
     GtkComboBoxText* combo_box = (GtkComboBoxText*) box;
     gchar* selection = gtk_combo_box_text_get_active_text(combo_box);
     std::string choice = (std::string) selection;
-    std::cout << "Loading map of " << choice  << ". Please wait a few moments." << std::endl;
 
-    closeMap();
-    bool load_success = false;
+    std::string map_path;
 
     if (choice == "Beijing"){
-        load_success = loadMap("/cad2/ece297s/public/maps/beijing_china.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/beijing_china.streets.bin";
     }
     else if (choice == "Boston"){
-        load_success = loadMap("/cad2/ece297s/public/maps/beijing_china.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/beijing_china.streets.bin";
     }
     else if (choice == "Cape Town"){
-        load_success = loadMap("/cad2/ece297s/public/maps/cape-town_south-africa.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/cape-town_south-africa.streets.bin";
     }
     else if (choice == "Golden Horseshoe"){
-        load_success = loadMap("/cad2/ece297s/public/maps/golden-horseshoe_canada.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/golden-horseshoe_canada.streets.bin";
     }
     else if (choice == "Hamilton"){
-        load_success = loadMap("/cad2/ece297s/public/maps/hamilton_canada.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/hamilton_canada.streets.bin";
     }
     else if (choice == "Hong Kong"){
-        load_success = loadMap("/cad2/ece297s/public/maps/hong-kong_china.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/hong-kong_china.streets.bin";
     }
     else if (choice == "Iceland"){
-        load_success = loadMap("/cad2/ece297s/public/maps/iceland.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/iceland.streets.bin";
     }
     else if (choice == "Interlaken"){
-        load_success = loadMap("/cad2/ece297s/public/maps/interlaken_switzerland.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/interlaken_switzerland.streets.bin";
     }
     else if (choice == "Kyiv"){
-        load_success = loadMap("/cad2/ece297s/public/maps/kyiv_ukraine.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/kyiv_ukraine.streets.bin";
     }
     else if (choice == "London"){
-        load_success = loadMap("/cad2/ece297s/public/maps/london_england.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/london_england.streets.bin";
     }
     else if (choice == "New Delhi"){
-        load_success = loadMap("/cad2/ece297s/public/maps/new-delhi_india.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/new-delhi_india.streets.bin";
     }
     else if (choice == "New York"){
-        load_success = loadMap("/cad2/ece297s/public/maps/new-york_usa.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/new-york_usa.streets.bin";
     }
     else if (choice == "Rio de Janeiro"){
-        load_success = loadMap("/cad2/ece297s/public/maps/rio-de-janeiro_brazil.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/rio-de-janeiro_brazil.streets.bin";
     }
     else if (choice == "Saint Helena"){
-        load_success = loadMap("/cad2/ece297s/public/maps/saint-helena.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/saint-helena.streets.bin";
     }
     else if (choice == "Singapore"){
-        load_success = loadMap("/cad2/ece297s/public/maps/singapore.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/singapore.streets.bin";
     }
     else if (choice == "Sydney"){
-        load_success = loadMap("/cad2/ece297s/public/maps/sydney_australia.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/sydney_australia.streets.bin";
     }
     else if (choice == "Tehran"){
-        load_success = loadMap("/cad2/ece297s/public/maps/tehran_iran.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/tehran_iran.streets.bin";
     }
     else if (choice == "Tokyo"){
-        load_success = loadMap("/cad2/ece297s/public/maps/tokyo_japan.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/tokyo_japan.streets.bin";
     }
     else if (choice == "Toronto"){
-        load_success = loadMap("/cad2/ece297s/public/maps/toronto_canada.streets.bin");
+        map_path = "/cad2/ece297s/public/maps/toronto_canada.streets.bin";
+    }
+
+    if (map_path.empty()){
+        return;
+    }
+
+    // Load in the background, the status bar shows the progress until checkMapLoad swaps the new map in
+    loading_map_name = choice;
+    startMapLoad(map_path);
+    application->update_message("Loading " + choice + "...");
+    application->refresh_drawing();
+    if (!map_load_timer){
+        map_load_timer = true;
+        g_timeout_add(100, checkMapLoad, application);
+    }
+}
+
+// Timer callback while a map loads in the background
+// Shows the load progress in the status bar, then shows the new map once it is ready
+gboolean checkMapLoad(gpointer data){
+    ezgl::application* application = (ezgl::application*) data;
+    map_load_status status = pollMapLoad();
+
+    if (status == MAP_LOAD_RUNNING){
+        std::stringstream ss;
+        ss << "Loading " << loading_map_name << "...";
+        const char* phase = load_progress.last_phase;
+        if (phase != nullptr){
+            ss << " " << phase << " done (" << load_progress.phases_done << " phases)";
+        }
+        application->update_message(ss.str());
+        return TRUE;
     }
 
-    if (load_success){ 
-        refreshMap(application); 
+    map_load_timer = false;
+    // The old map's UI state, the worker leaves it alone while GTK may read it.
+    // The highlight indices may be past the end of the new map's stores
+    POI_on.clear();
+    POI_on.resize(num_POI_categories);
+    nav_segments.clear();
+    inter_last = 0;
+    POI_prev = 0;
+    if (!loaded_map_path.empty()){
+        refreshMap(application);
         auto canvas = application->get_canvas("MainCanvas");
         ezgl::zoom_fit(canvas, canvas->get_camera().get_initial_world());
     }
+    if (status == MAP_LOAD_DONE){
+        application->update_message("Loaded " + loading_map_name);
+    }
+    else{
+        application->update_message("Couldn't load " + loading_map_name);
+    }
+    application->refresh_drawing();
+    return FALSE;
+}
+
+// Timer callback while loadOSMLayer runs in the background after startup
+gboolean checkOSMLayerLoad(gpointer data){
+    if (!OSMLayerLoadFinished()){
+        return TRUE;
+    }
+    ezgl::application* application = (ezgl::application*) data;
+    // A map switched to meanwhile was loaded in full
+    if (OSM_layer_loaded || mapLoading()){
+        application->refresh_drawing();
+    }
+    else{
+        application->update_message("Couldn't load the OSM layer, points of interest are hidden");
+    }
+    return FALSE;
+}
+
+// False, with a note in the status bar, while there is no map to act on
+bool mapReady(ezgl::application* application){
+    if (mapLoading()){
+        application->update_message("Loading " + loading_map_name + ", please wait");
+        return false;
+    }
+    return !loaded_map_path.empty();
 }
 
 // Callback function
@@ -1299,6 +1520,9 @@ void langChoice(GtkComboBox* box, ezgl::application* application){
 // highlight to true for the pin to be drawn
 // Not case sensitive, but doesn't work with partial names
 void enterSearch(GtkEntry* search_bar, ezgl::application* application) {
+    if (!mapReady(application)){
+        return;
+    }
     const gchar *search_text = gtk_entry_get_text(search_bar);
     double x = 0;
     double y = 0;
@@ -1310,18 +1534,18 @@ void enterSearch(GtkEntry* search_bar, ezgl::application* application) {
 
     for (POIIdx i = 0; i < POI_data.size(); i++){
         // Making it so it's not case sensitive
-        check_2 = toLowerRemoveSpace(POI_data[i].name);
+        check_2 = toLowerRemoveSpace(std::string(POI_data.name(i)));
 
         if (check_1 == check_2){
-            POI_data[POI_prev].highlight = false;
-            POI_data[i].highlight = true;
-            intersection_data[inter_last].highlight = false;
+            POI_data.setHighlight(POI_prev, false);
+            POI_data.setHighlight(i, true);
+            intersection_data.setHighlight(inter_last, false);
             application->refresh_drawing();
             POI_prev = i;
             found = true;
-            x = POI_data[i].pos.x;
-            y = POI_data[i].pos.y;
-            found_text = POI_data[i].name;
+            x = POI_data.pos(i).x;
+            y = POI_data.pos(i).y;
+            found_text = POI_data.name(i);
         }
     }
 
@@ -1341,14 +1565,10 @@ void enterSearch(GtkEntry* search_bar, ezgl::application* application) {
 
 // Helper function that draws navigation path onto the map 
 void drawPath(std::vector<StreetSegmentIdx> segments, ezgl::renderer* g, double scale_factor){
+    TRACE_SCOPE("drawPath");
     for (auto it = segments.begin(); it != segments.end(); it++){
-        ezgl::point2d med;
-        med.x = segment_intersections[*it].first.pos.x + ((segment_intersections[*it].second.pos.x - segment_intersections[*it].first.pos.x) / 2);
-        med.y = segment_intersections[*it].first.pos.y + ((segment_intersections[*it].second.pos.y - segment_intersections[*it].first.pos.y) / 2);
-        if (directions == true && (isVisible(segment_intersections[*it].first.pos, g) || isVisible(segment_intersections[*it].second.pos, g) || isVisible(med, g))){
+        if (directions == true && segmentIsVisible(*it, g)){
             StreetSegmentInfo info = getStreetSegmentInfo(*it);
-            std::string type = getOSMWayTagValue(info.wayOSMID, "highway");
-            std::string st_name = getStreetName(info.streetID);
             
             ezgl::line_dash dash = (ezgl::line_dash) 0;
             g -> set_line_dash(dash);
@@ -1479,7 +1699,7 @@ void secondIntersection(ezgl::application* application){
                 else {
                     text = "Turn left on ";
                 }
-                text = g_strconcat(text, intersection_data[turn].name.c_str(), NULL);
+                text = g_strconcat(text, intersection_data.name(turn).data(), NULL);
                 addDirection(text, dir, row, application);
                 meters = 0;
                 row++;
@@ -1521,10 +1741,10 @@ int findDirection(StreetSegmentIdx src, StreetSegmentIdx dest){
     StreetSegmentInfo src_info = getStreetSegmentInfo(src);
     StreetSegmentInfo dest_info = getStreetSegmentInfo(dest);
 
-    ezgl::point2d src_from = intersection_data[src_info.from].pos;
-    ezgl::point2d src_to = intersection_data[src_info.to].pos;
-    ezgl::point2d dest_from = intersection_data[dest_info.from].pos;
-    ezgl::point2d dest_to = intersection_data[dest_info.to].pos;
+    ezgl::point2d src_from = intersection_data.pos(src_info.from);
+    ezgl::point2d src_to = intersection_data.pos(src_info.to);
+    ezgl::point2d dest_from = intersection_data.pos(dest_info.from);
+    ezgl::point2d dest_to = intersection_data.pos(dest_info.to);
     double src_x, src_y, dest_x, dest_y;
 
     if (src_info.to == dest_info.to){
@@ -1569,4 +1789,10 @@ int findDirection(StreetSegmentIdx src, StreetSegmentIdx dest){
     }
 
     return 0; // If none of the above statements causes a return, then angle == 0 so return 0 for forward
-}
\ No newline at end of file
+}
+
+// Memory report lines for the UI state
+void addDrawMemoryUsage(std::vector<memory_usage>& report){
+    report.push_back(measureMemory("POI_on", POI_on.size(), POI_on));
+    report.push_back(measureMemory("nav_segments", nav_segments.size(), nav_segments));
+}
@@ -7,6 +7,8 @@
 #include <chrono>
 #include <sstream>
 #include "globals.h"
+#include "memory_report.h"
+#include "trace.h"
 #include <fstream>
 #include <string>
 #include <vector>
@@ -33,8 +35,8 @@ std::vector<StreetSegmentIdx> AStarfindPath (int, int, double);
 bool findPath (int,int);
 
 struct Node{
-    // Outgoing edges
-    std::vector<int> outgoingedges;
+    // Outgoing edges, a view of intersection_street_segments
+    array_view<StreetSegmentIdx> outgoingedges;
     // Street segment id of edge used to reach this node
     int reachingEdge; 
     // Shortest time found to this node so far
@@ -74,6 +76,7 @@ struct Greater{
    
 // bool function to see if there is a path or not
 bool findPath (int srcID, int destID){
+    TRACE_SCOPE("findPath");
     // Queue to hold nodes to explore next, ordered by those with 
     // Smallest besttimes first to find shortest path quicker
     std::priority_queue<WaveElem, std::vector<WaveElem>, Greater> wavefront; // nodes to explore next
@@ -185,6 +188,7 @@ std::vector<StreetSegmentIdx> makeVecFromList(std::list<StreetSegmentIdx>& path)
 
 // Function to trace back through the nodes
 std::vector<StreetSegmentIdx> bfsTraceBack (int destID) {
+    TRACE_SCOPE("bfsTraceBack");
     std::list <StreetSegmentIdx> path;
     
     int currNodeID = destID;
@@ -216,6 +220,7 @@ std::vector<StreetSegmentIdx> bfsTraceBack (int destID) {
 // of street segment ids; traversing these street segments, in the returned 
 // order, would take one from the start to the destination intersection.
 std::vector<StreetSegmentIdx> findPathBetweenIntersections(const double turn_penalty, const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids){
+    TRACE_SCOPE("findPathBetweenIntersections");
     int num_intersections = getNumIntersections();
     
     nodes.clear();
@@ -223,7 +228,7 @@ std::vector<StreetSegmentIdx> findPathBetweenIntersections(const double turn_pen
     
     for (int i = 0; i < num_intersections; i++){
         // int street_segments_of_intersection = findStreetSegmentsOfIntersection(i);
-        nodes[i].outgoingedges = findStreetSegmentsOfIntersection(i);
+        nodes[i].outgoingedges = streetSegmentsOfIntersection(i);
         nodes[i].bestTime = -1;
         // nodes[i].already_visited = false;
     }
@@ -239,3 +244,11 @@ std::vector<StreetSegmentIdx> findPathBetweenIntersections(const double turn_pen
     
     return shortest_path;
 }
+
+// Memory report lines for the path finding buffers
+void addPathMemoryUsage(std::vector<memory_usage>& report){
+    report.push_back(measureMemory("travel_times", travel_times.size(), travel_times));
+    report.push_back(measureMemory("connecting_streets", connecting_streets.size(), connecting_streets));
+    report.push_back(measureMemory("nodes", nodes.size(), nodes));
+    report.push_back(measureMemory("shortest_path", shortest_path.size(), shortest_path));
+}
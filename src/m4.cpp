@@ -24,6 +24,9 @@
 #include "m4.h"
 #include "m3.h"
 #include "globals.h"
+#include "distance_kernel.h"
+#include "memory_report.h"
+#include "trace.h"
 #include <algorithm>
 #include <omp.h>
 #include <cstdlib>
@@ -98,7 +101,7 @@ struct Node{
 
 std::vector<IntersectionIdx> startPath(const std::vector<DeliveryInf>& deliveries, const IntersectionIdx start_depot, const IntersectionIdx start_pickup);
 
-bool isLegal(std::unordered_multimap<IntersectionIdx, IntersectionIdx> legal_deliveries, IntersectionIdx loc);
+bool isLegal(const std::unordered_multimap<IntersectionIdx, IntersectionIdx>& legal_deliveries, IntersectionIdx loc);
 void preloadDistances(const std::vector<DeliveryInf>& deliveries, const std::vector<IntersectionIdx>& depots);
 // locationInfo findNext(IntersectionIdx next);
 void multiDestDijkstra (int turn_penalty, const std::vector<DeliveryInf>& deliveries, const std::vector<IntersectionIdx>& depots);
@@ -117,25 +120,33 @@ void legalPath(const std::vector<DeliveryInf>& deliveries, std::vector<Intersect
 
 // Preloads the geometric distances between all delivery points and depots
 void preloadDistances(const std::vector<DeliveryInf>& deliveries, const std::vector<IntersectionIdx>& depots){
+    TRACE_SCOPE("preloadDistances");
+    // Pick ups and drop offs laid out for the batch distance kernel, so each
+    // location gets its distances to all of them in one pass
+    distance_batch pick_ups, drop_offs;
+    for (int j = 0; j < deliveries.size(); j++){
+        pick_ups.push_back(getIntersectionPosition(deliveries[j].pickUp));
+        drop_offs.push_back(getIntersectionPosition(deliveries[j].dropOff));
+    }
+
     // Load depot_list with closest pickup location for each depot
     double min_dist = 100000000000000000000;
     IntersectionIdx min_loc = 0;
     for (int i = 0; i < depots.size(); i++){
         LatLon pd = getIntersectionPosition(depots[i]);
-        for (int j = 0; j < deliveries.size(); j++){
-            LatLon p1 = getIntersectionPosition(deliveries[j].pickUp);
-            double dist = findDistanceBetweenTwoPoints(pd, p1);
+        double dist;
+        int closest = closestInBatch(pd, pick_ups, dist);
 
-            if (dist < min_dist){
-                min_dist = dist;
-                min_loc = deliveries[j].pickUp;
-            }
+        if (closest != -1 && dist < min_dist){
+            min_dist = dist;
+            min_loc = deliveries[closest].pickUp;
         }
         depot_list.insert(std::make_pair(depots[i], min_loc));
     }
 
     // Load delivery_list with geometric distances
     //delivery_list.resize(getNumIntersections());
+    std::vector<double> dist1, dist2, dist3, dist4;
     for (int k = 0; k < deliveries.size(); k++){
         IntersectionIdx loc1 = deliveries[k].pickUp;
         LatLon p1 = getIntersectionPosition(loc1);
@@ -148,22 +159,20 @@ void preloadDistances(const std::vector<DeliveryInf>& deliveries, const std::vec
         map1.insert(std::make_pair(dist, loc2));
         map2.insert(std::make_pair(dist, loc1));
 
+        distancesFrom(p1, pick_ups, dist1);
+        distancesFrom(p1, drop_offs, dist2);
+        distancesFrom(p2, pick_ups, dist3);
+        distancesFrom(p2, drop_offs, dist4);
         for (int n = 0; n < deliveries.size(); n++){
             if (k != n){
                 IntersectionIdx loc3 = deliveries[n].pickUp;
                 IntersectionIdx loc4 = deliveries[n].dropOff;
-                LatLon p3 = getIntersectionPosition(loc3);
-                LatLon p4 = getIntersectionPosition(loc4);
-
-                double dist1 = findDistanceBetweenTwoPoints(p1, p3);
-                double dist2 = findDistanceBetweenTwoPoints(p1, p4);
-                map1.insert(std::make_pair(dist1, loc3));
-                map1.insert(std::make_pair(dist2, loc4));
-
-                double dist3 = findDistanceBetweenTwoPoints(p2, p3);
-                double dist4 = findDistanceBetweenTwoPoints(p2, p4);
-                map2.insert(std::make_pair(dist3, loc3));
-                map2.insert(std::make_pair(dist4, loc4));
+
+                map1.insert(std::make_pair(dist1[n], loc3));
+                map1.insert(std::make_pair(dist2[n], loc4));
+
+                map2.insert(std::make_pair(dist3[n], loc3));
+                map2.insert(std::make_pair(dist4[n], loc4));
             }
         }
 
@@ -251,6 +260,7 @@ struct CourierSubPath {
 // If no valid route to make *all* the deliveries exists, this routine must
 // return an empty (size == 0) vector.
 std::vector<CourierSubPath> travelingCourier(const float turn_penalty,const std::vector<DeliveryInf>& deliveries, const std::vector<IntersectionIdx>& depots){
+    TRACE_SCOPE("travelingCourier");
     preloadDistances(deliveries, depots);
     
     std::vector<CourierSubPath> c_path;
@@ -299,6 +309,7 @@ std::vector<CourierSubPath> travelingCourier(const float turn_penalty,const std:
         //#pragma omp parallel for
         //for (int i = 0; i < 2000; i++){
         while (delta.count() < 0.5*TIME_LIMIT){
+            TRACE_SCOPE("Multistart iteration");
             // n = rand()%depots_size;
             d = rand()%deliveries_size;
             i_path_temp = startPath(deliveries, depots[0], deliveries[d].pickUp);
@@ -314,7 +325,6 @@ std::vector<CourierSubPath> travelingCourier(const float turn_penalty,const std:
 
             now = std::chrono::high_resolution_clock::now();
             delta = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
-            //std::cout << "MULTISTART | Current time: " << delta.count() << ", Current cost: " << curr_cost << std::endl;
             //n++;
         }
         //d++;
@@ -328,6 +338,7 @@ std::vector<CourierSubPath> travelingCourier(const float turn_penalty,const std:
         int t = 123456;
 
         while (delta.count() < 0.8*TIME_LIMIT){
+            TRACE_SCOPE("Annealing iteration");
             i_path_iter = i_path_temp;
             perturb(i_path_iter);
             legalPath(deliveries, i_path_iter);
@@ -351,7 +362,6 @@ std::vector<CourierSubPath> travelingCourier(const float turn_penalty,const std:
 
             now = std::chrono::high_resolution_clock::now();
             delta = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
-            //std::cout << "ANNEALING | Current time: " << delta.count() << ", Current cost: " << curr_cost << ", Current iter_cost: " << iter_cost<< std::endl;
         }
     }
 
@@ -410,6 +420,7 @@ void legalPath(const std::vector<DeliveryInf>& deliveries, std::vector<Intersect
 }
 
 std::vector<IntersectionIdx> startPath(const std::vector<DeliveryInf>& deliveries, const IntersectionIdx start_depot, const IntersectionIdx start_pickup){
+    TRACE_SCOPE("startPath");
     // Initial Setup
     std::vector<IntersectionIdx> i_path;
     std::unordered_multimap<IntersectionIdx, IntersectionIdx> to_deliver;
@@ -471,18 +482,13 @@ std::vector<IntersectionIdx> startPath(const std::vector<DeliveryInf>& deliverie
     return i_path;
 }
 
-bool isLegal(std::unordered_multimap<IntersectionIdx, IntersectionIdx> legal_deliveries, IntersectionIdx loc){
-    bool legal = false;
-    for (auto it = legal_deliveries.begin(); it != legal_deliveries.end(); it++){
-        if (it->first == loc){
-            legal = true;
-        }
-    }
-
-    return legal;
+// A location is legal if it is still a key of legal_deliveries
+bool isLegal(const std::unordered_multimap<IntersectionIdx, IntersectionIdx>& legal_deliveries, IntersectionIdx loc){
+    return legal_deliveries.find(loc) != legal_deliveries.end();
 }
 
 double pathCost(const float turn_penalty, std::vector<CourierSubPath>&path){
+    TRACE_SCOPE("pathCost");
     double travel_time = 0;
     for (int i = 0; i < path.size(); i++){
         travel_time += computePathTravelTime(turn_penalty, path[i].subpath);
@@ -491,6 +497,7 @@ double pathCost(const float turn_penalty, std::vector<CourierSubPath>&path){
 }
 
 std::vector<CourierSubPath> IdxtoPath(const float turn_penalty, std::vector<IntersectionIdx>&path){
+    TRACE_SCOPE("IdxtoPath");
     std::vector<CourierSubPath> c_path;
     c_path.resize(path.size() - 1);
 
@@ -640,4 +647,20 @@ void time(const std::vector<DeliveryInf>& deliveries, const std::vector<Intersec
         key_intersections[i]= depots.[i];
     }
 }
- * */
\ No newline at end of file
+ * */
+
+void addHeapUsage(memory_usage& usage, const CourierSubPath& sub_path){
+    addHeapUsage(usage, sub_path.subpath);
+}
+
+// Memory report lines for the courier buffers
+void addCourierMemoryUsage(std::vector<memory_usage>& report){
+    report.push_back(measureMemory("intersection_ids", intersection_ids.size(), intersection_ids));
+    report.push_back(measureMemory("path", path.size(), path));
+    report.push_back(measureMemory("paths", paths.size(), paths));
+    report.push_back(measureMemory("path_nodes", path_nodes.size(), path_nodes));
+    report.push_back(measureMemory("dist_btw_path_nodes", dist_btw_path_nodes.size(), dist_btw_path_nodes));
+    report.push_back(measureMemory("delivery_list", delivery_list.size(), delivery_list));
+    report.push_back(measureMemory("depot_list", depot_list.size(), depot_list));
+    report.push_back(measureMemory("key_intersections", key_intersections.size(), key_intersections));
+}
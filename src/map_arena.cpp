@@ -0,0 +1,26 @@
+#include "map_arena.h"
+
+map_arena::map_arena(std::pmr::memory_resource* upstream, bool shared_arena, size_t chunk_bytes)
+    : buffer(chunk_bytes, upstream), shared(shared_arena){}
+
+void* map_arena::do_allocate(size_t bytes, size_t alignment){
+    if (!shared){
+        allocated += bytes;
+        return buffer.allocate(bytes, alignment);
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    allocated += bytes;
+    return buffer.allocate(bytes, alignment);
+}
+
+void map_arena::release(){
+    buffer.release();
+    allocated = 0;
+}
+
+std::pmr::memory_resource* mapMemory(){
+    if (map_memory){
+        return map_memory.get();
+    }
+    return std::pmr::new_delete_resource();
+}
@@ -0,0 +1,58 @@
+#ifndef MAP_ARENA_H
+#define MAP_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+
+// Monotonic arena for the derived data of one map
+//
+// Allocations are carved out of a few large chunks and deallocate does
+// nothing, so a structure built in an arena is freed all at once by
+// destroying (or releasing) the arena instead of one block at a time. Each
+// map owns one (map_memory for the current map, map_state::arena for a
+// parked one) and the string pools of the map take their memory from it
+// through arenas of their own (see string_pool.h). A shared arena locks
+// around every allocation, so pools built by concurrent load phases can
+// draw from the same map arena.
+//
+// An arena must outlive everything allocated from it. Its chunks are at
+// least MAP_ARENA_CHUNK_BYTES, and every map frees the same few chunk sizes,
+// so switching between maps reuses the freed chunks instead of growing the heap
+#define MAP_ARENA_CHUNK_BYTES (1 << 20)
+
+struct map_arena : std::pmr::memory_resource{
+    std::pmr::monotonic_buffer_resource buffer;
+    bool shared;
+    std::mutex lock;
+    // Bytes handed out, for the memory report
+    size_t allocated = 0;
+
+    explicit map_arena(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource(), bool shared_arena = false,
+                       size_t chunk_bytes = MAP_ARENA_CHUNK_BYTES);
+
+    size_t bytes() const{
+        return allocated;
+    }
+
+    // Frees every chunk, whatever was allocated from the arena is gone
+    void release();
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override{}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override{
+        return this == &other;
+    }
+};
+
+// Arena of the current map, null when no map is open. Defined in m1.cpp
+// ahead of the structures that use it, so it is destroyed after them
+extern std::unique_ptr<map_arena> map_memory;
+
+// Where a new per-map structure gets its memory: the current map's arena,
+// or the heap if no map is open
+std::pmr::memory_resource* mapMemory();
+
+#endif /* MAP_ARENA_H */
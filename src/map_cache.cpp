@@ -0,0 +1,106 @@
+#include "map_cache.h"
+#include "memory_report.h"
+#include "trace.h"
+#include <list>
+
+// A parked map and the bytes its structures take
+struct resident_map{
+    std::string streets_path;
+    size_t bytes = 0;
+    map_state state;
+};
+
+size_t map_cache_budget = size_t(MAP_CACHE_BUDGET_MB)*1024*1024;
+// Most recently used first
+std::list<resident_map> resident_maps;
+
+// Heap bytes of the current map's structures
+size_t currentMapBytes(){
+    std::vector<memory_usage> report;
+    addMapMemoryUsage(report);
+    size_t bytes = 0;
+    for (auto const& usage : report){
+        bytes += usage.bytes;
+    }
+    return bytes;
+}
+
+// Drops the least recently used parked maps until everything fits the budget
+void evictResidentMaps(size_t current_bytes){
+    size_t total_bytes = current_bytes;
+    for (auto const& map : resident_maps){
+        total_bytes += map.bytes;
+    }
+    while (!resident_maps.empty() && total_bytes > map_cache_budget){
+        total_bytes -= resident_maps.back().bytes;
+        resident_maps.pop_back();
+    }
+}
+
+void setMapCacheBudget(size_t bytes){
+    map_cache_budget = bytes;
+    evictResidentMaps(loaded_map_path.empty() ? 0 : currentMapBytes());
+}
+
+bool switchMap(const std::string& streets_path){
+    TRACE_SCOPE("switchMap");
+    if (streets_path == loaded_map_path){
+        return true;
+    }
+
+    // Park the current map, its structures move out and the globals are left empty
+    // A map whose OSM layer never finished loading is closed instead
+    if (!loaded_map_path.empty() && OSM_layer_loaded){
+        resident_map parked;
+        parked.streets_path = loaded_map_path;
+        parked.bytes = currentMapBytes();
+        swapMapState(parked.state);
+        resident_maps.push_front(std::move(parked));
+    }
+    closeCurrentMap();
+
+    auto it = resident_maps.begin();
+    while (it != resident_maps.end() && it -> streets_path != streets_path){
+        it++;
+    }
+
+    bool load_success = false;
+    if (it != resident_maps.end()){
+        // Only the streets database is reopened. The OSM tag indexes come back with
+        // the map, so its OSM database (next to the streets file) waits for openOSMDatabase
+        std::string osm_path = streets_path;
+        size_t suffix = osm_path.rfind(".streets.bin");
+        if (suffix != std::string::npos){
+            osm_path.replace(suffix, std::string(".streets.bin").size(), ".osm.bin");
+            load_success = loadStreetsDatabaseBIN(streets_path);
+        }
+        if (load_success){
+            swapMapState(it -> state);
+            loaded_map_path = streets_path;
+            closed_OSM_database = osm_path;
+        }
+        resident_maps.erase(it);
+    }
+    else{
+        load_success = loadMap(streets_path);
+    }
+
+    if (!load_success){
+        closeCurrentMap();
+        return false;
+    }
+    evictResidentMaps(currentMapBytes());
+    return true;
+}
+
+std::vector<std::string> residentMaps(){
+    std::vector<std::string> paths;
+    for (auto const& map : resident_maps){
+        paths.push_back(map.streets_path);
+    }
+    return paths;
+}
+
+void clearMapCache(){
+    resident_maps.clear();
+}
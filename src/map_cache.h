@@ -0,0 +1,75 @@
+#ifndef MAP_CACHE_H
+#define MAP_CACHE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "globals.h"
+
+// Everything loadMap derives for one map, the arena its string pools live
+// in and the snapshot it may have been read from. A map that isn't the current one keeps its structures here
+// (swapMapState moves them in and out of the globals), so switching back to
+// it needs no rebuild
+struct map_state{
+    // First, so it is destroyed after the structures allocated from it
+    std::unique_ptr<map_arena> arena;
+    std::unique_ptr<snapshot_mapping> snapshot;
+    map_projection projection;
+    double max_lat = 0, min_lat = 0, max_lon = 0, min_lon = 0;
+    csr_table<StreetSegmentIdx> intersection_street_segments;
+    street_prefix_index street_name_index;
+    street_fuzzy_index street_fuzzy_names;
+    string_pool street_name_pool;
+    mapped_vector<uint32_t> street_name_ids;
+    osm_tag_store OSM_node_tags;
+    osm_tag_store OSM_way_tags;
+    osm_id_index OSM_way_index;
+    mapped_vector<double> OSM_way_length;
+    osm_tag_projection_report OSM_tag_report;
+    mapped_vector<double> street_travel_time;
+    mapped_vector<double> street_lengths;
+    csr_table<IntersectionIdx> street_intersections;
+    street_crossing_index street_crossings;
+    point_store intersection_data;
+    latlon_kd_tree intersection_tree;
+    point_store POI_data;
+    poi_name_index POI_name_index;
+    mapped_vector<std::pair<IntersectionIdx, IntersectionIdx>> segment_intersections;
+    segment_geometry_store segment_geometry;
+    csr_table<StreetSegmentIdx> street_segments_of_street;
+    feature_geometry_store feature_geometry;
+    bool OSM_layer_loaded = false;
+};
+
+// Swaps the current map's derived structures with state, in O(1)
+void swapMapState(map_state& state);
+
+// Resident maps
+//
+// switchMap parks the current map's structures in memory instead of closing
+// them, so flipping back to a recently used city skips loadMap. Parked maps
+// are evicted least recently used first once the current map and the parked
+// ones together take more than the budget (measured like the memory report).
+// The streets database is global to its library and only holds one map, so
+// it is still reopened on every switch. The OSM database is left closed until
+// openOSMDatabase, the OSM tag indexes are parked with the rest of the map
+
+// Default budget for the current map plus the parked ones, in MB
+#define MAP_CACHE_BUDGET_MB 1024
+
+void setMapCacheBudget(size_t bytes);
+
+// Makes the map at streets_path current, from the cache if it is parked
+// there and with loadMap otherwise. Returns false if it couldn't be loaded,
+// and no map is open then
+bool switchMap(const std::string& streets_path);
+
+// Streets paths of the parked maps, most recently used first
+std::vector<std::string> residentMaps();
+
+// Frees every parked map (closeMap calls this)
+void clearMapCache();
+
+#endif /* MAP_CACHE_H */
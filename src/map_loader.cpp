@@ -0,0 +1,119 @@
+#include "map_loader.h"
+#include "map_cache.h"
+#include <thread>
+
+std::thread map_load_thread;
+// Set by the worker once switchMap has returned, map_load_success is valid then
+std::atomic<bool> map_load_finished{false};
+bool map_load_success = false;
+
+std::thread OSM_layer_thread;
+std::atomic<bool> OSM_layer_finished{false};
+
+// Only touched by the UI thread
+bool map_loading = false;
+std::string map_load_path;
+// Requested while the load in flight was being cancelled
+std::string pending_map_path;
+// Current map when the loads started, switched back to if they fail
+std::string previous_map_path;
+bool map_load_failed = false;
+
+// Starts a worker for streets_path, the previous worker must have finished
+void launchMapLoad(const std::string& streets_path){
+    if (map_load_thread.joinable()){
+        map_load_thread.join();
+    }
+    load_progress.cancel = false;
+    load_progress.phases_done = 0;
+    load_progress.last_phase = nullptr;
+    map_load_finished = false;
+    map_load_path = streets_path;
+
+    map_load_thread = std::thread([streets_path](){
+        // The OSM layer of the current map has to be complete before it is parked
+        if (OSM_layer_thread.joinable()){
+            OSM_layer_thread.join();
+        }
+        map_load_success = switchMap(streets_path);
+        map_load_finished = true;
+    });
+}
+
+void startMapLoad(const std::string& streets_path){
+    if (!map_loading){
+        map_loading = true;
+        map_load_failed = false;
+        previous_map_path = loaded_map_path;
+        launchMapLoad(streets_path);
+        return;
+    }
+
+    // The worker notices between phases, pollMapLoad starts this load once it has stopped
+    pending_map_path = streets_path;
+    load_progress.cancel = true;
+}
+
+map_load_status pollMapLoad(){
+    if (!map_loading){
+        return MAP_LOAD_IDLE;
+    }
+    if (!map_load_finished){
+        return MAP_LOAD_RUNNING;
+    }
+    map_load_thread.join();
+
+    if (!pending_map_path.empty()){
+        std::string streets_path = pending_map_path;
+        pending_map_path.clear();
+        map_load_failed = false;
+        launchMapLoad(streets_path);
+        return MAP_LOAD_RUNNING;
+    }
+
+    // The previous map is parked in the map cache, so getting it back is quick
+    if (!map_load_success && !map_load_failed && !previous_map_path.empty()){
+        map_load_failed = true;
+        launchMapLoad(previous_map_path);
+        return MAP_LOAD_RUNNING;
+    }
+
+    map_loading = false;
+    if (map_load_failed || !map_load_success){
+        return MAP_LOAD_FAILED;
+    }
+    return MAP_LOAD_DONE;
+}
+
+bool mapLoading(){
+    return map_loading;
+}
+
+std::string loadingMapPath(){
+    return map_load_path;
+}
+
+void startOSMLayerLoad(){
+    OSM_layer_finished = false;
+    OSM_layer_thread = std::thread([](){
+        loadOSMLayer();
+        OSM_layer_finished = true;
+    });
+}
+
+bool OSMLayerLoadFinished(){
+    return OSM_layer_finished;
+}
+
+void cancelMapLoad(){
+    pending_map_path.clear();
+    load_progress.cancel = true;
+    if (map_load_thread.joinable()){
+        map_load_thread.join();
+    }
+    if (OSM_layer_thread.joinable()){
+        OSM_layer_thread.join();
+    }
+    load_progress.cancel = false;
+    map_loading = false;
+}
@@ -0,0 +1,59 @@
+#ifndef MAP_LOADER_H
+#define MAP_LOADER_H
+
+#include <atomic>
+#include <string>
+
+// Progress of the loadMap call in flight, written by loadMap and read by the
+// UI thread while a map loads in the background
+struct map_load_progress{
+    // Set to stop the load, loadMap skips its remaining phases and fails
+    std::atomic<bool> cancel{false};
+    std::atomic<int> phases_done{0};
+    // Name of the last phase that finished, nullptr before the first one
+    std::atomic<const char*> last_phase{nullptr};
+};
+
+extern map_load_progress load_progress;
+
+// Background map loading
+//
+// A worker thread runs switchMap, so the map being replaced is parked in the
+// map cache and comes back instantly if the new one fails to load. The map
+// globals and the streets/OSM databases belong to the worker until
+// pollMapLoad reports the load is over, so the UI must not read them while
+// mapLoading() is true. Everything here is called from the UI thread
+
+enum map_load_status{
+    MAP_LOAD_IDLE,
+    MAP_LOAD_RUNNING,
+    // The requested map is now the current one
+    MAP_LOAD_DONE,
+    // The requested map couldn't be loaded, the previous one is current again if there was one
+    MAP_LOAD_FAILED
+};
+
+// Starts loading streets_path in the background. A load already in flight
+// is cancelled and this one starts as soon as it has stopped
+void startMapLoad(const std::string& streets_path);
+
+// Checks on the worker, starting any queued load. Call it periodically while mapLoading()
+map_load_status pollMapLoad();
+
+bool mapLoading();
+
+// Path of the map being loaded
+std::string loadingMapPath();
+
+// Runs loadOSMLayer on a worker after a loadMap call with defer_OSM_layer
+// set. A map load started meanwhile waits for it before switching maps
+void startOSMLayerLoad();
+
+// True once the worker has returned, OSM_layer_loaded says whether it succeeded
+bool OSMLayerLoadFinished();
+
+// Cancels the loads in flight and waits for the workers to stop. The map
+// being replaced stays parked in the map cache, so no map may be current after
+void cancelMapLoad();
+
+#endif /* MAP_LOADER_H */
@@ -0,0 +1,746 @@
+#include "map_snapshot.h"
+#include "globals.h"
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <type_traits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// ------------- Snapshot File Layout -------------
+//
+//   snapshot_header
+//   snapshot_section[num_sections]
+//   payload (sections, each 8 byte aligned)
+//
+// Every section is a sequence of arrays. Each array is a uint64 element count
+// followed by the raw elements, padded to 8 bytes, so the reader can point the
+// structures straight into the mapping. Every section must be there.
+//
+// Reading only checks the shape of the arrays, that their counts agree with
+// each other, in O(1) per array. Their contents are covered by the checksum,
+// nothing scans them element by element.
+
+const char snapshot_magic[8] = {'B', 'B', 'S', 'N', 'A', 'P', 0, 0};
+
+bool check_snapshot_checksum = true;
+
+struct snapshot_header{
+    char magic[8];
+    uint32_t version;
+    uint32_t num_sections;
+    // Size and modification time of the map files the snapshot was derived from
+    uint64_t streets_size;
+    uint64_t streets_mtime;
+    uint64_t osm_size;
+    uint64_t osm_mtime;
+    // Signature of the OSM tag projection the tag stores were built with
+    uint64_t tag_projection;
+    // sizeof(geometry_coord), so a snapshot of quantized geometry isn't read as doubles
+    uint32_t geometry_coord_bytes;
+    uint32_t reserved;
+    uint64_t payload_bytes;
+    uint64_t checksum;
+};
+
+struct snapshot_section{
+    uint32_t id;
+    uint32_t reserved;
+    // Relative to the start of the payload
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+enum snapshot_section_id{
+    SECTION_BOUNDS = 1,
+    SECTION_INTERSECTIONS,
+    SECTION_SEGMENTS,
+    SECTION_STREETS,
+    SECTION_POIS,
+    SECTION_FEATURES,
+    SECTION_STREET_NAMES,
+    SECTION_OSM_NODE_TAGS,
+    SECTION_OSM_WAY_TAGS,
+    SECTION_OSM_WAY_LENGTHS,
+    SECTION_TAG_REPORT,
+    SECTION_INTERSECTION_TREE,
+    SECTION_STREET_CROSSINGS,
+    SECTION_SEGMENT_GEOMETRY,
+    NUM_SECTION_IDS
+};
+
+// segment_intersections is read and written as a flat array of ids
+static_assert(sizeof(std::pair<IntersectionIdx, IntersectionIdx>) == 2*sizeof(IntersectionIdx), "segment endpoints must be two packed ids");
+
+// Helper Function Prototypes
+bool fileStamp(const std::string& path, uint64_t& size, uint64_t& mtime);
+uint64_t snapshotChecksum(const char* data, uint64_t bytes);
+
+// ------------- Writing -------------
+
+// Appends sections and arrays to an in memory payload
+struct snapshot_writer{
+    std::vector<snapshot_section> sections;
+    std::vector<char> payload;
+
+    void align(){
+        payload.resize((payload.size() + 7) & ~uint64_t(7), 0);
+    }
+
+    void beginSection(uint32_t id){
+        align();
+        sections.push_back({id, 0, payload.size(), 0});
+    }
+
+    void endSection(){
+        align();
+        sections.back().bytes = payload.size() - sections.back().offset;
+    }
+
+    template <typename T>
+    void putArray(const T* data, uint64_t count){
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot arrays must be trivially copyable");
+        const char* count_bytes = reinterpret_cast<const char*>(&count);
+        payload.insert(payload.end(), count_bytes, count_bytes + sizeof(count));
+        if (count > 0){
+            const char* bytes = reinterpret_cast<const char*>(data);
+            payload.insert(payload.end(), bytes, bytes + count*sizeof(T));
+        }
+        align();
+    }
+
+    // A std::vector or mapped_vector
+    template <typename Vector>
+    void putVector(const Vector& data){
+        putArray(data.data(), data.size());
+    }
+};
+
+// String pool as its strings back to back, each followed by a NUL, their
+// offsets and its hash table, the layout string_pool::view takes
+void putStringPool(snapshot_writer& writer, const string_pool& pool){
+    std::vector<char> chars;
+    std::vector<uint64_t> offsets(1, 0);
+    for (uint32_t i = 0; i < pool.size(); i++){
+        std::string_view str = pool.get(i);
+        chars.insert(chars.end(), str.begin(), str.end());
+        chars.push_back('\0');
+        offsets.push_back(chars.size());
+    }
+    writer.putVector(chars);
+    writer.putVector(offsets);
+    writer.putVector(pool.slots);
+}
+
+// CSR table as its offsets and values
+template <typename T>
+void putCsrTable(snapshot_writer& writer, const csr_table<T>& table){
+    writer.putVector(table.offsets);
+    writer.putVector(table.values);
+}
+
+// Point store as its coordinates, name pool in id order and name ids
+// Highlights are UI state and aren't saved
+void putPointStore(snapshot_writer& writer, const point_store& points){
+    writer.putVector(points.x);
+    writer.putVector(points.y);
+    putStringPool(writer, points.names);
+    writer.putVector(points.name_ids);
+}
+
+// Geometry blocks as their origin, bytes and block and item tables. The
+// decoded block cache isn't saved
+void putGeometryBlocks(snapshot_writer& writer, const geometry_blocks& blocks){
+    double origin[2] = {blocks.origin_x, blocks.origin_y};
+    writer.putArray(origin, 2);
+    writer.putVector(blocks.bytes);
+    writer.putVector(blocks.block_offsets);
+    writer.putVector(blocks.block_y_offsets);
+    writer.putVector(blocks.block_vertices);
+    writer.putVector(blocks.item_blocks);
+    writer.putVector(blocks.item_firsts);
+    writer.putVector(blocks.item_counts);
+}
+
+// Id index as its sorted ids and their values
+void putIdIndex(snapshot_writer& writer, const osm_id_index& index){
+    writer.putVector(index.ids);
+    writer.putVector(index.values);
+}
+
+// KD-tree as its points, ids and split axes in tree order
+void putKdTree(snapshot_writer& writer, const latlon_kd_tree& tree){
+    writer.putArray(&tree.min_cos_lat, 1);
+    writer.putVector(tree.points);
+    writer.putVector(tree.ids);
+    writer.putVector(tree.axis);
+}
+
+// Crossing index as its entries, hash slots and per street partner lists
+void putCrossingIndex(snapshot_writer& writer, const street_crossing_index& index){
+    writer.putVector(index.entry_keys);
+    writer.putVector(index.entry_offsets);
+    writer.putVector(index.intersections);
+    writer.putVector(index.slots);
+    writer.putVector(index.partner_offsets);
+    writer.putVector(index.partners);
+}
+
+// Tag store as its string pool in id order, its id index and the flat tag ranges
+void putTagStore(snapshot_writer& writer, const osm_tag_store& store){
+    putStringPool(writer, store.strings);
+    putIdIndex(writer, store.object_slot);
+    writer.putVector(store.tag_offsets);
+    writer.putVector(store.tags);
+}
+
+bool writeMapSnapshot(const std::string& snapshot_path, const std::string& streets_path, const std::string& osm_path){
+    snapshot_header header;
+    std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+    header.version = SNAPSHOT_VERSION;
+    header.tag_projection = OSM_tag_projection.signature();
+    header.geometry_coord_bytes = sizeof(geometry_coord);
+    header.reserved = 0;
+    if (!fileStamp(streets_path, header.streets_size, header.streets_mtime) || !fileStamp(osm_path, header.osm_size, header.osm_mtime)){
+        return false;
+    }
+
+    snapshot_writer writer;
+
+    writer.beginSection(SECTION_BOUNDS);
+    double bounds[5] = {min_lat, max_lat, min_lon, max_lon, projection.avg_lat};
+    writer.putArray(bounds, 5);
+    writer.endSection();
+
+    writer.beginSection(SECTION_INTERSECTIONS);
+    putPointStore(writer, intersection_data);
+    putCsrTable(writer, intersection_street_segments);
+    writer.endSection();
+
+    // Segment endpoints as a flat from, to, from, to, ... array of intersection
+    // ids, the layout of the (from, to) pairs
+    writer.beginSection(SECTION_SEGMENTS);
+    writer.putArray(reinterpret_cast<const IntersectionIdx*>(segment_intersections.data()), 2*segment_intersections.size());
+    writer.putVector(street_travel_time);
+    writer.endSection();
+
+    writer.beginSection(SECTION_STREETS);
+    writer.putVector(street_lengths);
+    putCsrTable(writer, street_segments_of_street);
+    putCsrTable(writer, street_intersections);
+    writer.endSection();
+
+    writer.beginSection(SECTION_POIS);
+    putPointStore(writer, POI_data);
+    putStringPool(writer, POI_name_index.names);
+    writer.putVector(POI_name_index.bucket_offsets);
+    writer.putVector(POI_name_index.pois);
+    putKdTree(writer, POI_name_index.trees);
+    writer.endSection();
+
+    writer.beginSection(SECTION_FEATURES);
+    writer.putVector(feature_geometry.offsets);
+    writer.putVector(feature_geometry.xs);
+    writer.putVector(feature_geometry.ys);
+    putGeometryBlocks(writer, feature_geometry.packed);
+    writer.putVector(feature_geometry.areas);
+    writer.putVector(feature_geometry.min_xs);
+    writer.putVector(feature_geometry.min_ys);
+    writer.putVector(feature_geometry.max_xs);
+    writer.putVector(feature_geometry.max_ys);
+    writer.putVector(feature_geometry.closed);
+    writer.endSection();
+
+    writer.beginSection(SECTION_STREET_NAMES);
+    writer.putVector(street_name_index.chars);
+    writer.putVector(street_name_index.name_offsets);
+    writer.putVector(street_name_index.street_offsets);
+    writer.putVector(street_name_index.street_ids);
+    writer.putVector(street_fuzzy_names.gram_keys);
+    writer.putVector(street_fuzzy_names.gram_offsets);
+    writer.putVector(street_fuzzy_names.postings);
+    putStringPool(writer, street_name_pool);
+    writer.putVector(street_name_ids);
+    writer.endSection();
+
+    writer.beginSection(SECTION_OSM_NODE_TAGS);
+    putTagStore(writer, OSM_node_tags);
+    writer.endSection();
+
+    writer.beginSection(SECTION_OSM_WAY_TAGS);
+    putTagStore(writer, OSM_way_tags);
+    writer.endSection();
+
+    writer.beginSection(SECTION_OSM_WAY_LENGTHS);
+    putIdIndex(writer, OSM_way_index);
+    writer.putVector(OSM_way_length);
+    writer.endSection();
+
+    writer.beginSection(SECTION_INTERSECTION_TREE);
+    putKdTree(writer, intersection_tree);
+    writer.endSection();
+
+    // The polylines in packed form if they are packed, flat otherwise
+    writer.beginSection(SECTION_SEGMENT_GEOMETRY);
+    putGeometryBlocks(writer, segment_geometry.packed);
+    if (segment_geometry.packed.empty()){
+        putCsrTable(writer, segment_geometry.polylines);
+    }
+    writer.putVector(segment_geometry.lengths);
+    writer.putVector(segment_geometry.from_bearings);
+    writer.putVector(segment_geometry.to_bearings);
+    writer.endSection();
+
+    writer.beginSection(SECTION_STREET_CROSSINGS);
+    putCrossingIndex(writer, street_crossings);
+    writer.endSection();
+
+    writer.beginSection(SECTION_TAG_REPORT);
+    writer.putArray(&OSM_tag_report, 1);
+    writer.endSection();
+
+    header.num_sections = writer.sections.size();
+    header.payload_bytes = writer.payload.size();
+    header.checksum = snapshotChecksum(writer.payload.data(), writer.payload.size());
+
+    // Write to a temporary file first so a crash never leaves a half written snapshot behind
+    std::string temp_path = snapshot_path + ".tmp";
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out.good()){
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(writer.sections.data()), writer.sections.size()*sizeof(snapshot_section));
+    out.write(writer.payload.data(), writer.payload.size());
+    out.close();
+
+    if (!out.good() || std::rename(temp_path.c_str(), snapshot_path.c_str()) != 0){
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ------------- Reading -------------
+
+// Walks the arrays of one section inside the mapping
+struct snapshot_reader{
+    const char* cursor;
+    const char* end;
+    bool ok = true;
+
+    // Returns a pointer to the next array inside the mapping, or nullptr if the section is too short
+    template <typename T>
+    const T* getArray(uint64_t& count){
+        count = 0;
+        if (!ok || end - cursor < (long) sizeof(uint64_t)){
+            ok = false;
+            return nullptr;
+        }
+        std::memcpy(&count, cursor, sizeof(count));
+        cursor += sizeof(count);
+        if (count > uint64_t(end - cursor)/sizeof(T)){
+            ok = false;
+            return nullptr;
+        }
+        const T* data = reinterpret_cast<const T*>(cursor);
+        cursor += (count*sizeof(T) + 7) & ~uint64_t(7);
+        return data;
+    }
+
+    // Points out at the next array, in place
+    template <typename T>
+    void getVector(mapped_vector<T>& out){
+        uint64_t count;
+        const T* data = getArray<T>(count);
+        if (ok){
+            out.view(data, count);
+        }
+    }
+};
+
+// Offsets have to start at 0 and end at the number of values
+template <typename T>
+void getCsrTable(snapshot_reader& reader, csr_table<T>& table){
+    reader.getVector(table.offsets);
+    reader.getVector(table.values);
+    if (!reader.ok || table.offsets.empty() || table.offsets.front() != 0 || table.offsets.back() != table.values.size()){
+        reader.ok = false;
+    }
+}
+
+// The offsets have to span the chars, and the hash table has to be a power
+// of two with an empty slot for probes to stop at
+void getStringPool(snapshot_reader& reader, string_pool& pool){
+    uint64_t num_chars, num_offsets, num_slots;
+    const char* chars = reader.getArray<char>(num_chars);
+    const uint64_t* offsets = reader.getArray<uint64_t>(num_offsets);
+    const uint32_t* slots = reader.getArray<uint32_t>(num_slots);
+    if (!reader.ok || num_offsets == 0 || offsets[0] != 0 || offsets[num_offsets - 1] != num_chars
+        || (num_slots & (num_slots - 1)) != 0 || 2*(num_offsets - 1) > num_slots){
+        reader.ok = false;
+        return;
+    }
+    pool.view(chars, offsets, num_offsets - 1, slots, num_slots);
+}
+
+// Highlights are UI state, every point starts unhighlighted
+void getPointStore(snapshot_reader& reader, point_store& points){
+    reader.getVector(points.x);
+    reader.getVector(points.y);
+    getStringPool(reader, points.names);
+    reader.getVector(points.name_ids);
+    if (!reader.ok || points.x.size() != points.y.size() || points.name_ids.size() != points.x.size()){
+        reader.ok = false;
+        return;
+    }
+    points.highlight.assign((points.size() + 63)/64, 0);
+}
+
+void getGeometryBlocks(snapshot_reader& reader, geometry_blocks& blocks){
+    uint64_t count;
+    const double* origin = reader.getArray<double>(count);
+    reader.getVector(blocks.bytes);
+    reader.getVector(blocks.block_offsets);
+    reader.getVector(blocks.block_y_offsets);
+    reader.getVector(blocks.block_vertices);
+    reader.getVector(blocks.item_blocks);
+    reader.getVector(blocks.item_firsts);
+    reader.getVector(blocks.item_counts);
+    if (!reader.ok || count != 2 || blocks.item_firsts.size() != blocks.item_blocks.size()
+        || blocks.item_counts.size() != blocks.item_blocks.size()){
+        reader.ok = false;
+        return;
+    }
+    blocks.origin_x = origin[0];
+    blocks.origin_y = origin[1];
+    if (blocks.empty()){
+        return;
+    }
+
+    if (blocks.block_offsets.size() != blocks.numBlocks() + 1 || blocks.block_y_offsets.size() != blocks.numBlocks()
+        || blocks.block_offsets.front() != 0 || blocks.block_offsets.back() != blocks.bytes.size()){
+        reader.ok = false;
+    }
+}
+
+void getIdIndex(snapshot_reader& reader, osm_id_index& index){
+    reader.getVector(index.ids);
+    reader.getVector(index.values);
+    if (!reader.ok || index.ids.size() != index.values.size()){
+        reader.ok = false;
+    }
+}
+
+void getKdTree(snapshot_reader& reader, latlon_kd_tree& tree){
+    uint64_t count;
+    const double* min_cos_lat = reader.getArray<double>(count);
+    reader.getVector(tree.points);
+    reader.getVector(tree.ids);
+    reader.getVector(tree.axis);
+    if (!reader.ok || count != 1 || tree.ids.size() != tree.points.size() || tree.axis.size() != tree.points.size()){
+        reader.ok = false;
+        return;
+    }
+    tree.min_cos_lat = *min_cos_lat;
+}
+
+void getCrossingIndex(snapshot_reader& reader, street_crossing_index& index){
+    reader.getVector(index.entry_keys);
+    reader.getVector(index.entry_offsets);
+    reader.getVector(index.intersections);
+    reader.getVector(index.slots);
+    reader.getVector(index.partner_offsets);
+    reader.getVector(index.partners);
+    // Probing relies on a power of two table with at least one empty slot
+    if (!reader.ok || index.entry_offsets.size() != index.entry_keys.size() + 1
+        || index.slots.size() <= index.entry_keys.size() || (index.slots.size() & (index.slots.size() - 1)) != 0
+        || index.partners.size() != 2*index.entry_keys.size() || index.partner_offsets.empty()){
+        reader.ok = false;
+    }
+}
+
+void getTagStore(snapshot_reader& reader, osm_tag_store& store){
+    getStringPool(reader, store.strings);
+    getIdIndex(reader, store.object_slot);
+    reader.getVector(store.tag_offsets);
+    reader.getVector(store.tags);
+    if (!reader.ok || (store.tag_offsets.empty() ? !store.tags.empty() : store.tag_offsets.back() != store.tags.size())){
+        reader.ok = false;
+    }
+}
+
+// Fills the derived structures from one section
+void readSnapshotSection(uint32_t id, snapshot_reader& reader){
+    uint64_t count;
+
+    if (id == SECTION_BOUNDS){
+        const double* bounds = reader.getArray<double>(count);
+        if (!reader.ok || count != 5){
+            reader.ok = false;
+            return;
+        }
+        min_lat = bounds[0];
+        max_lat = bounds[1];
+        min_lon = bounds[2];
+        max_lon = bounds[3];
+        projection = map_projection(min_lat, max_lat, min_lon, max_lon);
+    }
+    else if (id == SECTION_INTERSECTIONS){
+        getPointStore(reader, intersection_data);
+        getCsrTable(reader, intersection_street_segments);
+    }
+    else if (id == SECTION_SEGMENTS){
+        const IntersectionIdx* endpoints = reader.getArray<IntersectionIdx>(count);
+        reader.getVector(street_travel_time);
+        if (!reader.ok || count % 2 != 0 || street_travel_time.size() != count/2){
+            reader.ok = false;
+            return;
+        }
+        segment_intersections.view(reinterpret_cast<const std::pair<IntersectionIdx, IntersectionIdx>*>(endpoints), count/2);
+    }
+    else if (id == SECTION_STREETS){
+        reader.getVector(street_lengths);
+        getCsrTable(reader, street_segments_of_street);
+        getCsrTable(reader, street_intersections);
+    }
+    else if (id == SECTION_POIS){
+        getPointStore(reader, POI_data);
+
+        getStringPool(reader, POI_name_index.names);
+        reader.getVector(POI_name_index.bucket_offsets);
+        reader.getVector(POI_name_index.pois);
+        getKdTree(reader, POI_name_index.trees);
+        if (!reader.ok || POI_name_index.bucket_offsets.size() != POI_name_index.names.size() + 1
+            || POI_name_index.bucket_offsets.back() != POI_name_index.pois.size()
+            || POI_name_index.trees.size() != POI_name_index.pois.size()){
+            reader.ok = false;
+        }
+    }
+    else if (id == SECTION_FEATURES){
+        feature_geometry_store& features = feature_geometry;
+        reader.getVector(features.offsets);
+        reader.getVector(features.xs);
+        reader.getVector(features.ys);
+        getGeometryBlocks(reader, features.packed);
+        reader.getVector(features.areas);
+        reader.getVector(features.min_xs);
+        reader.getVector(features.min_ys);
+        reader.getVector(features.max_xs);
+        reader.getVector(features.max_ys);
+        reader.getVector(features.closed);
+        size_t num_features = features.areas.size();
+        if (!reader.ok || features.offsets.size() != num_features + 1 || features.offsets[0] != 0
+            || (features.packed.empty() ? features.xs.size() != features.offsets.back() : features.packed.size() != num_features || !features.xs.empty())
+            || features.ys.size() != features.xs.size()
+            || features.min_xs.size() != num_features || features.min_ys.size() != num_features
+            || features.max_xs.size() != num_features || features.max_ys.size() != num_features
+            || features.closed.size() != num_features){
+            reader.ok = false;
+        }
+    }
+    else if (id == SECTION_STREET_NAMES){
+        reader.getVector(street_name_index.chars);
+        reader.getVector(street_name_index.name_offsets);
+        reader.getVector(street_name_index.street_offsets);
+        reader.getVector(street_name_index.street_ids);
+        reader.getVector(street_fuzzy_names.gram_keys);
+        reader.getVector(street_fuzzy_names.gram_offsets);
+        reader.getVector(street_fuzzy_names.postings);
+        if (!reader.ok || street_name_index.name_offsets.size() != street_name_index.street_offsets.size()
+            || (!street_name_index.name_offsets.empty() && (street_name_index.name_offsets.back() != street_name_index.chars.size()
+            || street_name_index.street_offsets.back() != street_name_index.street_ids.size()))
+            || street_fuzzy_names.gram_offsets.size() != street_fuzzy_names.gram_keys.size() + 1
+            || street_fuzzy_names.gram_offsets.back() != street_fuzzy_names.postings.size()){
+            reader.ok = false;
+            return;
+        }
+
+        getStringPool(reader, street_name_pool);
+        reader.getVector(street_name_ids);
+    }
+    else if (id == SECTION_OSM_NODE_TAGS){
+        getTagStore(reader, OSM_node_tags);
+    }
+    else if (id == SECTION_OSM_WAY_TAGS){
+        getTagStore(reader, OSM_way_tags);
+    }
+    else if (id == SECTION_OSM_WAY_LENGTHS){
+        getIdIndex(reader, OSM_way_index);
+        reader.getVector(OSM_way_length);
+        if (!reader.ok || OSM_way_length.size() != OSM_way_index.size()){
+            reader.ok = false;
+        }
+    }
+    else if (id == SECTION_INTERSECTION_TREE){
+        getKdTree(reader, intersection_tree);
+    }
+    else if (id == SECTION_SEGMENT_GEOMETRY){
+        getGeometryBlocks(reader, segment_geometry.packed);
+        if (segment_geometry.packed.empty()){
+            getCsrTable(reader, segment_geometry.polylines);
+        }
+        reader.getVector(segment_geometry.lengths);
+        reader.getVector(segment_geometry.from_bearings);
+        reader.getVector(segment_geometry.to_bearings);
+        size_t num_segments = segment_geometry.lengths.size();
+        size_t num_polylines = segment_geometry.packed.empty() ? segment_geometry.polylines.size() : segment_geometry.packed.size();
+        if (!reader.ok || num_polylines != num_segments
+            || segment_geometry.from_bearings.size() != num_segments || segment_geometry.to_bearings.size() != num_segments){
+            reader.ok = false;
+        }
+    }
+    else if (id == SECTION_STREET_CROSSINGS){
+        getCrossingIndex(reader, street_crossings);
+    }
+    else if (id == SECTION_TAG_REPORT){
+        const osm_tag_projection_report* report = reader.getArray<osm_tag_projection_report>(count);
+        if (!reader.ok || count != 1){
+            reader.ok = false;
+            return;
+        }
+        OSM_tag_report = *report;
+    }
+}
+
+snapshot_mapping::~snapshot_mapping(){
+    munmap(data, bytes);
+}
+
+bool readMapSnapshot(const std::string& snapshot_path, const std::string& streets_path, const std::string& osm_path){
+    int fd = open(snapshot_path.c_str(), O_RDONLY);
+    if (fd < 0){
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(snapshot_header)){
+        close(fd);
+        return false;
+    }
+    uint64_t file_bytes = info.st_size;
+
+    // Private and writable, so a structure that writes into its view copies
+    // only the pages it touches and the file never changes
+    void* data = mmap(NULL, file_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED){
+        return false;
+    }
+    std::unique_ptr<snapshot_mapping> mapping = std::make_unique<snapshot_mapping>(data, file_bytes);
+    const char* base = static_cast<const char*>(data);
+
+    // Validate the header against the map files and the payload against its checksum
+    snapshot_header header;
+    std::memcpy(&header, base, sizeof(header));
+    uint64_t streets_size, streets_mtime, osm_size, osm_mtime;
+    uint64_t table_bytes = uint64_t(header.num_sections)*sizeof(snapshot_section);
+
+    bool valid = std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) == 0
+        && header.version == SNAPSHOT_VERSION
+        && fileStamp(streets_path, streets_size, streets_mtime)
+        && fileStamp(osm_path, osm_size, osm_mtime)
+        && header.streets_size == streets_size && header.streets_mtime == streets_mtime
+        && header.osm_size == osm_size && header.osm_mtime == osm_mtime
+        && header.tag_projection == OSM_tag_projection.signature()
+        && header.geometry_coord_bytes == sizeof(geometry_coord)
+        && sizeof(header) + table_bytes + header.payload_bytes == file_bytes;
+
+    const snapshot_section* sections = reinterpret_cast<const snapshot_section*>(base + sizeof(header));
+    const char* payload = base + sizeof(header) + table_bytes;
+
+    // Reads every page of the snapshot, so it is skippable for big maps
+    if (valid && check_snapshot_checksum){
+        valid = snapshotChecksum(payload, header.payload_bytes) == header.checksum;
+    }
+
+    bool found[NUM_SECTION_IDS] = {};
+    for (uint32_t i = 0; valid && i < header.num_sections; i++){
+        if (sections[i].offset > header.payload_bytes || sections[i].bytes > header.payload_bytes - sections[i].offset){
+            valid = false;
+            break;
+        }
+        snapshot_reader reader{payload + sections[i].offset, payload + sections[i].offset + sections[i].bytes};
+        readSnapshotSection(sections[i].id, reader);
+        valid = reader.ok;
+        if (sections[i].id < NUM_SECTION_IDS){
+            found[sections[i].id] = true;
+        }
+    }
+    for (uint32_t id = SECTION_BOUNDS; valid && id < NUM_SECTION_IDS; id++){
+        valid = found[id];
+    }
+
+    if (!valid){
+        std::cout << "Map snapshot " << snapshot_path << " is out of date or corrupt, rebuilding" << std::endl;
+        // Throw away anything that was read before the bad section, the
+        // mapping goes after the views into it
+        intersection_data.clear();
+        intersection_street_segments.clear();
+        intersection_tree.clear();
+        segment_intersections.clear();
+        segment_geometry.clear();
+        street_travel_time.clear();
+        street_lengths.clear();
+        street_segments_of_street.clear();
+        street_intersections.clear();
+        street_crossings.clear();
+        POI_data.clear();
+        POI_name_index.clear();
+        feature_geometry.clear();
+        street_name_index.clear();
+        street_fuzzy_names.clear();
+        street_name_pool.clear();
+        street_name_ids.clear();
+        OSM_node_tags.clear();
+        OSM_way_tags.clear();
+        OSM_way_index.clear();
+        OSM_way_length.clear();
+        return false;
+    }
+    map_snapshot = std::move(mapping);
+    return true;
+}
+
+// ------------- Helper Functions -------------
+
+std::string snapshotPathForMap(const std::string& streets_path){
+    std::string path = streets_path;
+    std::string from = ".streets.bin";
+    size_t pos = path.rfind(from);
+    if (pos != std::string::npos){
+        path.erase(pos, from.length());
+    }
+    return path + ".snapshot.bin";
+}
+
+// Size and modification time (ns) of a file, used to detect map files that changed
+bool fileStamp(const std::string& path, uint64_t& size, uint64_t& mtime){
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0){
+        return false;
+    }
+    size = info.st_size;
+    mtime = uint64_t(info.st_mtim.tv_sec)*1000000000ull + info.st_mtim.tv_nsec;
+    return true;
+}
+
+// 64-bit FNV-1a style hash over 8 byte words, much faster than byte at a time on large payloads
+uint64_t snapshotChecksum(const char* data, uint64_t bytes){
+    uint64_t hash = 14695981039346656037ull;
+    uint64_t i = 0;
+    for (; i + 8 <= bytes; i += 8){
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < bytes; i++){
+        hash = (hash ^ uint8_t(data[i])) * 1099511628211ull;
+    }
+    return hash;
+}
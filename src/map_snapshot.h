@@ -0,0 +1,56 @@
+#ifndef MAP_SNAPSHOT_H
+#define MAP_SNAPSHOT_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// A snapshot is a binary cache of everything loadMap derives from the
+// .streets.bin/.osm.bin pair. It is written next to the map the first time the
+// map is loaded, and memory mapped on later loads. The derived structures are
+// then views into the mapping (see mapped_vector.h), string pools and hash
+// tables included, so nothing is copied or rebuilt and the mapping stays open
+// as long as the map does.
+//
+// A snapshot is only used if its version matches SNAPSHOT_VERSION, its
+// checksum is intact, it was built with the current OSM tag projection, and
+// the size and modification time of both map files match the ones recorded
+// when it was written. Otherwise loadMap falls back to a full load and writes
+// a fresh snapshot.
+
+// Bump whenever the layout of any section changes
+#define SNAPSHOT_VERSION 18
+
+// Set before loadMap to skip the checksum, which reads the whole snapshot.
+// Pages are then only read as the map uses them, but a corrupt snapshot is
+// only caught if its header or array counts are off
+extern bool check_snapshot_checksum;
+
+// A snapshot mapped for the lifetime of a map, unmapped when destroyed
+struct snapshot_mapping{
+    void* data;
+    size_t bytes;
+
+    snapshot_mapping(void* mapping, size_t mapping_bytes) : data(mapping), bytes(mapping_bytes){}
+    snapshot_mapping(const snapshot_mapping&) = delete;
+    snapshot_mapping& operator=(const snapshot_mapping&) = delete;
+    ~snapshot_mapping();
+};
+
+// Snapshot the current map was read from, null if it was built from the map
+// files. Defined in m1.cpp ahead of the structures that view it
+extern std::unique_ptr<snapshot_mapping> map_snapshot;
+
+// Path of the snapshot for the given .streets.bin file
+std::string snapshotPathForMap(const std::string& streets_path);
+
+// Fills the derived map structures from the snapshot at snapshot_path and
+// keeps it mapped in map_snapshot. Returns false (and leaves the structures
+// empty) if the snapshot is missing, stale, corrupt or lacks a section
+bool readMapSnapshot(const std::string& snapshot_path, const std::string& streets_path, const std::string& osm_path);
+
+// Writes the currently loaded derived map structures to snapshot_path
+// Returns false if the snapshot could not be written (e.g. read only map directory)
+bool writeMapSnapshot(const std::string& snapshot_path, const std::string& streets_path, const std::string& osm_path);
+
+#endif /* MAP_SNAPSHOT_H */
@@ -0,0 +1,227 @@
+#ifndef MAPPED_VECTOR_H
+#define MAPPED_VECTOR_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "array_view.h"
+
+// Flat array that either owns its elements (a std::vector) or is a view of
+// elements that live elsewhere, the map snapshot mapping (see map_snapshot.h),
+// so a structure read from a snapshot is used in place instead of copied.
+// first/count always describe the elements, so reads cost the same either
+// way. Anything that changes the size copies a view into owned storage first.
+// The snapshot is mapped copy on write, so writing elements of a view in
+// place only copies the pages it touches.
+//
+// A view is only valid while its mapping is, which is the lifetime of the map
+template <typename T>
+struct mapped_vector{
+    std::vector<T> owned;
+    T* first = nullptr;
+    size_t count = 0;
+
+    mapped_vector(){}
+
+    mapped_vector(const mapped_vector& other) : owned(other.begin(), other.end()){
+        sync();
+    }
+
+    mapped_vector(mapped_vector&& other) noexcept : owned(std::move(other.owned)), first(other.first), count(other.count){
+        other.first = nullptr;
+        other.count = 0;
+    }
+
+    mapped_vector& operator=(const mapped_vector& other){
+        if (this != &other){
+            owned.assign(other.begin(), other.end());
+            sync();
+        }
+        return *this;
+    }
+
+    mapped_vector& operator=(mapped_vector&& other) noexcept{
+        if (this != &other){
+            owned = std::move(other.owned);
+            first = other.first;
+            count = other.count;
+            other.first = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+
+    mapped_vector& operator=(std::vector<T>&& elements){
+        owned = std::move(elements);
+        sync();
+        return *this;
+    }
+
+    // Makes this a view of count elements at data
+    void view(const T* data, size_t num_elements){
+        owned = std::vector<T>();
+        first = const_cast<T*>(data);
+        count = num_elements;
+    }
+
+    bool mapped() const{
+        return first != owned.data();
+    }
+
+    size_t size() const{
+        return count;
+    }
+
+    bool empty() const{
+        return count == 0;
+    }
+
+    size_t capacity() const{
+        return mapped() ? count : owned.capacity();
+    }
+
+    T* data(){
+        return first;
+    }
+
+    const T* data() const{
+        return first;
+    }
+
+    T* begin(){
+        return first;
+    }
+
+    T* end(){
+        return first + count;
+    }
+
+    const T* begin() const{
+        return first;
+    }
+
+    const T* end() const{
+        return first + count;
+    }
+
+    T& operator[](size_t i){
+        return first[i];
+    }
+
+    const T& operator[](size_t i) const{
+        return first[i];
+    }
+
+    T& front(){
+        return first[0];
+    }
+
+    const T& front() const{
+        return first[0];
+    }
+
+    T& back(){
+        return first[count - 1];
+    }
+
+    const T& back() const{
+        return first[count - 1];
+    }
+
+    operator array_view<T>() const{
+        return array_view<T>(first, count);
+    }
+
+    // ------------- Changes, a view is copied into owned storage first -------------
+
+    void push_back(const T& value){
+        own();
+        owned.push_back(value);
+        sync();
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... args){
+        own();
+        owned.emplace_back(std::forward<Args>(args)...);
+        sync();
+    }
+
+    void pop_back(){
+        own();
+        owned.pop_back();
+        sync();
+    }
+
+    void resize(size_t num_elements){
+        own();
+        owned.resize(num_elements);
+        sync();
+    }
+
+    void resize(size_t num_elements, const T& value){
+        own();
+        owned.resize(num_elements, value);
+        sync();
+    }
+
+    void assign(size_t num_elements, const T& value){
+        owned.assign(num_elements, value);
+        sync();
+    }
+
+    template <typename It>
+    void assign(It from, It to){
+        owned.assign(from, to);
+        sync();
+    }
+
+    template <typename It>
+    T* insert(T* position, It from, It to){
+        size_t index = position - first;
+        own();
+        owned.insert(owned.begin() + index, from, to);
+        sync();
+        return first + index;
+    }
+
+    T* erase(T* from, T* to){
+        size_t index = from - first;
+        own();
+        owned.erase(owned.begin() + index, owned.begin() + (to - from) + index);
+        sync();
+        return first + index;
+    }
+
+    void reserve(size_t num_elements){
+        own();
+        owned.reserve(num_elements);
+        sync();
+    }
+
+    void shrink_to_fit(){
+        own();
+        owned.shrink_to_fit();
+        sync();
+    }
+
+    void clear(){
+        owned.clear();
+        sync();
+    }
+
+private:
+    // Copies a view into owned storage
+    void own(){
+        if (mapped()){
+            owned.assign(first, first + count);
+        }
+    }
+
+    void sync(){
+        first = owned.data();
+        count = owned.size();
+    }
+};
+
+#endif /* MAPPED_VECTOR_H */
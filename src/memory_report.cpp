@@ -0,0 +1,168 @@
+#include "memory_report.h"
+#include "globals.h"
+#include <algorithm>
+#include <fstream>
+#include <unistd.h>
+
+// Strings short enough for the small string buffer live inside the object
+void addHeapUsage(memory_usage& usage, const std::string& str){
+    const char* inside = reinterpret_cast<const char*>(&str);
+    if (str.data() < inside || str.data() >= inside + sizeof(str)){
+        usage.bytes += str.capacity() + 1;
+        usage.allocations++;
+    }
+}
+
+// The characters are counted as what the pool took from its arena, one
+// allocation however many chunks that spans
+void addHeapUsage(memory_usage& usage, const string_pool& pool){
+    if (pool.memory){
+        usage.bytes += pool.memory -> bytes();
+        usage.allocations++;
+    }
+    addHeapUsage(usage, pool.strings);
+    addHeapUsage(usage, pool.slots);
+}
+
+void addHeapUsage(memory_usage& usage, const osm_id_index& index){
+    addHeapUsage(usage, index.ids);
+    addHeapUsage(usage, index.values);
+}
+
+void addHeapUsage(memory_usage& usage, const osm_tag_store& store){
+    addHeapUsage(usage, store.strings);
+    addHeapUsage(usage, store.object_slot);
+    addHeapUsage(usage, store.tag_offsets);
+    addHeapUsage(usage, store.tags);
+    addHeapUsage(usage, store.pending_objects);
+}
+
+void addHeapUsage(memory_usage& usage, const street_prefix_index& index){
+    addHeapUsage(usage, index.chars);
+    addHeapUsage(usage, index.name_offsets);
+    addHeapUsage(usage, index.street_offsets);
+    addHeapUsage(usage, index.street_ids);
+}
+
+void addHeapUsage(memory_usage& usage, const street_fuzzy_index& index){
+    addHeapUsage(usage, index.gram_keys);
+    addHeapUsage(usage, index.gram_offsets);
+    addHeapUsage(usage, index.postings);
+}
+
+void addHeapUsage(memory_usage& usage, const latlon_kd_tree& tree){
+    addHeapUsage(usage, tree.points);
+    addHeapUsage(usage, tree.ids);
+    addHeapUsage(usage, tree.axis);
+}
+
+void addHeapUsage(memory_usage& usage, const poi_name_index& index){
+    addHeapUsage(usage, index.names);
+    addHeapUsage(usage, index.bucket_offsets);
+    addHeapUsage(usage, index.pois);
+    addHeapUsage(usage, index.trees);
+}
+
+void addHeapUsage(memory_usage& usage, const street_crossing_index& index){
+    addHeapUsage(usage, index.entry_keys);
+    addHeapUsage(usage, index.entry_offsets);
+    addHeapUsage(usage, index.intersections);
+    addHeapUsage(usage, index.slots);
+    addHeapUsage(usage, index.partner_offsets);
+    addHeapUsage(usage, index.partners);
+}
+
+void addHeapUsage(memory_usage& usage, const point_store& points){
+    addHeapUsage(usage, points.x);
+    addHeapUsage(usage, points.y);
+    addHeapUsage(usage, points.name_ids);
+    addHeapUsage(usage, points.names);
+    addHeapUsage(usage, points.highlight);
+}
+
+void addHeapUsage(memory_usage& usage, const geometry_blocks& blocks){
+    addHeapUsage(usage, blocks.bytes);
+    addHeapUsage(usage, blocks.block_offsets);
+    addHeapUsage(usage, blocks.block_y_offsets);
+    addHeapUsage(usage, blocks.block_vertices);
+    addHeapUsage(usage, blocks.item_blocks);
+    addHeapUsage(usage, blocks.item_firsts);
+    addHeapUsage(usage, blocks.item_counts);
+    addHeapUsage(usage, blocks.cache_slots);
+    // Decoded blocks, each with its own points array
+    if (blocks.cache.capacity() > 0){
+        usage.bytes += blocks.cache.capacity()*sizeof(blocks.cache[0]);
+        usage.allocations++;
+    }
+    for (const auto& block : blocks.cache){
+        addHeapUsage(usage, block.points);
+    }
+}
+
+void addHeapUsage(memory_usage& usage, const segment_geometry_store& geometry){
+    addHeapUsage(usage, geometry.polylines);
+    addHeapUsage(usage, geometry.packed);
+    addHeapUsage(usage, geometry.lengths);
+    addHeapUsage(usage, geometry.from_bearings);
+    addHeapUsage(usage, geometry.to_bearings);
+}
+
+void addHeapUsage(memory_usage& usage, const feature_geometry_store& geometry){
+    addHeapUsage(usage, geometry.offsets);
+    addHeapUsage(usage, geometry.xs);
+    addHeapUsage(usage, geometry.ys);
+    addHeapUsage(usage, geometry.packed);
+    addHeapUsage(usage, geometry.areas);
+    addHeapUsage(usage, geometry.min_xs);
+    addHeapUsage(usage, geometry.min_ys);
+    addHeapUsage(usage, geometry.max_xs);
+    addHeapUsage(usage, geometry.max_ys);
+    addHeapUsage(usage, geometry.closed);
+}
+
+std::vector<memory_usage> collectMemoryUsage(){
+    std::vector<memory_usage> report;
+    addMapMemoryUsage(report);
+    addDrawMemoryUsage(report);
+    addPathMemoryUsage(report);
+    addCourierMemoryUsage(report);
+    std::stable_sort(report.begin(), report.end(), [](const memory_usage& a, const memory_usage& b){
+        return a.bytes > b.bytes;
+    });
+    return report;
+}
+
+size_t processResidentBytes(){
+    // Second field of statm is the resident page count
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0, resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)){
+        return 0;
+    }
+    return resident_pages*sysconf(_SC_PAGESIZE);
+}
+
+void printMemoryReport(std::ostream& out, const std::vector<memory_usage>& report){
+    size_t total_bytes = 0, total_allocations = 0;
+    for (auto const& usage : report){
+        out << "  " << usage.name << ": " << usage.bytes/1024 << " KB, "
+            << usage.elements << " elements, " << usage.allocations << " allocations" << std::endl;
+        total_bytes += usage.bytes;
+        total_allocations += usage.allocations;
+    }
+    out << "  Total: " << total_bytes/1024 << " KB, " << total_allocations << " allocations" << std::endl;
+    out << "  Process RSS: " << processResidentBytes()/1024 << " KB" << std::endl;
+}
+
+void writeMemoryReportJson(std::ostream& out, const std::vector<memory_usage>& report){
+    // Structure names are plain identifiers, so they need no escaping
+    size_t total_bytes = 0;
+    out << "{\n  \"structures\": [";
+    for (size_t i = 0; i < report.size(); i++){
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"name\": \"" << report[i].name << "\", \"elements\": " << report[i].elements
+            << ", \"bytes\": " << report[i].bytes << ", \"allocations\": " << report[i].allocations << "}";
+        total_bytes += report[i].bytes;
+    }
+    out << "\n  ],\n  \"total_bytes\": " << total_bytes << ",\n  \"rss_bytes\": " << processResidentBytes() << "\n}" << std::endl;
+}
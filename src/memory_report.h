@@ -0,0 +1,166 @@
+#ifndef MEMORY_REPORT_H
+#define MEMORY_REPORT_H
+
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "csr_table.h"
+#include "mapped_vector.h"
+
+struct string_pool;
+struct osm_id_index;
+struct osm_tag_store;
+struct street_prefix_index;
+struct street_fuzzy_index;
+struct latlon_kd_tree;
+struct poi_name_index;
+struct street_crossing_index;
+struct point_store;
+struct geometry_blocks;
+struct segment_geometry_store;
+struct feature_geometry_store;
+
+// Heap memory held by one global structure (mapper --memory-report)
+// bytes is what the structure asked the allocator for, without allocator
+// overhead, and allocations is how many separate heap blocks that is.
+// Node based containers (maps, unordered_maps) are estimated from their
+// node and bucket counts, everything else is exact
+struct memory_usage{
+    std::string name;
+    size_t elements = 0;
+    size_t bytes = 0;
+    size_t allocations = 0;
+};
+
+// ------------- Heap usage of one object -------------
+// addHeapUsage adds the heap blocks owned by an object (not the object itself)
+
+void addHeapUsage(memory_usage& usage, const std::string& str);
+void addHeapUsage(memory_usage& usage, const string_pool& pool);
+void addHeapUsage(memory_usage& usage, const osm_id_index& index);
+void addHeapUsage(memory_usage& usage, const osm_tag_store& store);
+void addHeapUsage(memory_usage& usage, const street_prefix_index& index);
+void addHeapUsage(memory_usage& usage, const street_fuzzy_index& index);
+void addHeapUsage(memory_usage& usage, const latlon_kd_tree& tree);
+void addHeapUsage(memory_usage& usage, const poi_name_index& index);
+void addHeapUsage(memory_usage& usage, const street_crossing_index& index);
+void addHeapUsage(memory_usage& usage, const point_store& points);
+void addHeapUsage(memory_usage& usage, const geometry_blocks& blocks);
+void addHeapUsage(memory_usage& usage, const segment_geometry_store& geometry);
+void addHeapUsage(memory_usage& usage, const feature_geometry_store& geometry);
+template <typename T> void addHeapUsage(memory_usage& usage, const T& value);
+template <typename A, typename B> void addHeapUsage(memory_usage& usage, const std::pair<A, B>& value);
+template <typename T> void addHeapUsage(memory_usage& usage, const std::vector<T>& vec);
+template <typename T> void addHeapUsage(memory_usage& usage, const mapped_vector<T>& vec);
+template <typename T> void addHeapUsage(memory_usage& usage, const csr_table<T>& table);
+template <typename K, typename V, typename H, typename E, typename A> void addHeapUsage(memory_usage& usage, const std::unordered_map<K, V, H, E, A>& map);
+template <typename K, typename V, typename C, typename A> void addHeapUsage(memory_usage& usage, const std::multimap<K, V, C, A>& map);
+template <typename K, typename V, typename C, typename A> void addHeapUsage(memory_usage& usage, const std::map<K, V, C, A>& map);
+
+// Plain values (ints, doubles, points, views) own nothing
+template <typename T>
+void addHeapUsage(memory_usage&, const T&){
+    static_assert(std::is_trivially_copyable<T>::value, "add an addHeapUsage overload for this type");
+}
+
+template <typename A, typename B>
+void addHeapUsage(memory_usage& usage, const std::pair<A, B>& value){
+    addHeapUsage(usage, value.first);
+    addHeapUsage(usage, value.second);
+}
+
+template <typename T>
+void addHeapUsage(memory_usage& usage, const std::vector<T>& vec){
+    if (vec.capacity() > 0){
+        usage.bytes += vec.capacity()*sizeof(T);
+        usage.allocations++;
+    }
+    if (!std::is_trivially_copyable<T>::value){
+        for (auto const& element : vec){
+            addHeapUsage(usage, element);
+        }
+    }
+}
+
+// A view of the snapshot mapping isn't on the heap (see map_snapshot (mapped))
+template <typename T>
+void addHeapUsage(memory_usage& usage, const mapped_vector<T>& vec){
+    if (!vec.mapped()){
+        addHeapUsage(usage, vec.owned);
+    }
+}
+
+template <typename T>
+void addHeapUsage(memory_usage& usage, const csr_table<T>& table){
+    addHeapUsage(usage, table.offsets);
+    addHeapUsage(usage, table.values);
+}
+
+// One node per element (the value plus a next pointer) and the bucket array
+template <typename K, typename V, typename H, typename E, typename A>
+void addHeapUsage(memory_usage& usage, const std::unordered_map<K, V, H, E, A>& map){
+    usage.bytes += map.size()*(sizeof(std::pair<const K, V>) + sizeof(void*)) + map.bucket_count()*sizeof(void*);
+    usage.allocations += map.size() + (map.bucket_count() > 1);
+    for (auto const& entry : map){
+        addHeapUsage(usage, entry.first);
+        addHeapUsage(usage, entry.second);
+    }
+}
+
+// One red-black tree node per element (the value, three pointers and a colour)
+template <typename K, typename V, typename C, typename A>
+void addHeapUsage(memory_usage& usage, const std::multimap<K, V, C, A>& map){
+    usage.bytes += map.size()*(sizeof(std::pair<const K, V>) + 4*sizeof(void*));
+    usage.allocations += map.size();
+    for (auto const& entry : map){
+        addHeapUsage(usage, entry.first);
+        addHeapUsage(usage, entry.second);
+    }
+}
+
+template <typename K, typename V, typename C, typename A>
+void addHeapUsage(memory_usage& usage, const std::map<K, V, C, A>& map){
+    usage.bytes += map.size()*(sizeof(std::pair<const K, V>) + 4*sizeof(void*));
+    usage.allocations += map.size();
+    for (auto const& entry : map){
+        addHeapUsage(usage, entry.first);
+        addHeapUsage(usage, entry.second);
+    }
+}
+
+// One report line for a structure with the given number of elements
+template <typename T>
+memory_usage measureMemory(const char* name, size_t elements, const T& structure){
+    memory_usage usage;
+    usage.name = name;
+    usage.elements = elements;
+    addHeapUsage(usage, structure);
+    return usage;
+}
+
+// ------------- Report -------------
+
+// Each module adds a line per global structure it owns
+void addMapMemoryUsage(std::vector<memory_usage>& report);
+void addDrawMemoryUsage(std::vector<memory_usage>& report);
+void addPathMemoryUsage(std::vector<memory_usage>& report);
+void addCourierMemoryUsage(std::vector<memory_usage>& report);
+
+// Every module's lines, largest first
+std::vector<memory_usage> collectMemoryUsage();
+
+// Resident set size of the process in bytes, 0 if it can't be read
+size_t processResidentBytes();
+
+// Table with a total line and the process RSS for comparison
+void printMemoryReport(std::ostream& out, const std::vector<memory_usage>& report);
+
+// {"structures": [{"name", "elements", "bytes", "allocations"}, ...], "total_bytes", "rss_bytes"}
+void writeMemoryReportJson(std::ostream& out, const std::vector<memory_usage>& report);
+
+#endif /* MEMORY_REPORT_H */
@@ -0,0 +1,106 @@
+#include "osm_id_index.h"
+#include <algorithm>
+
+// Interpolation probes tried before falling back to binary search
+#define MAX_INTERPOLATION_PROBES 4
+
+void osm_id_index::build(std::vector<std::pair<uint64_t, uint32_t>>& entries){
+    // Stable, so the first of any repeated ids stays in front
+    std::stable_sort(entries.begin(), entries.end(), [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b){
+        return a.first < b.first;
+    });
+
+    ids.clear();
+    values.clear();
+    ids.reserve(entries.size());
+    values.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); i++){
+        if (!ids.empty() && ids.back() == entries[i].first){
+            continue;
+        }
+        ids.push_back(entries[i].first);
+        values.push_back(entries[i].second);
+    }
+}
+
+uint32_t osm_id_index::find(OSMID id) const{
+    uint64_t key = static_cast<uint64_t>(id);
+    if (ids.empty() || key < ids.front() || key > ids.back()){
+        return NO_OSM_POSITION;
+    }
+
+    // Search window is ids[lo] to ids[hi], both inclusive, and always contains key's spot
+    size_t lo = 0;
+    size_t hi = ids.size() - 1;
+    for (int probe = 0; probe < MAX_INTERPOLATION_PROBES && ids[lo] != ids[hi]; probe++){
+        double fraction = double(key - ids[lo])/double(ids[hi] - ids[lo]);
+        size_t pos = std::min(hi, lo + size_t(fraction*(hi - lo)));
+
+        if (ids[pos] == key){
+            return pos;
+        }
+        else if (ids[pos] < key){
+            lo = pos + 1;
+        }
+        else{
+            hi = pos - 1;
+        }
+
+        if (lo > hi || key < ids[lo] || key > ids[hi]){
+            return NO_OSM_POSITION;
+        }
+    }
+
+    auto it = std::lower_bound(ids.begin() + lo, ids.begin() + hi + 1, key);
+    if (it == ids.begin() + hi + 1 || *it != key){
+        return NO_OSM_POSITION;
+    }
+    return it - ids.begin();
+}
+
+void osm_id_index::findBatch(const std::vector<OSMID>& ids_to_find, std::vector<uint32_t>& positions) const{
+    positions.resize(ids_to_find.size());
+
+    uint32_t last_hit = NO_OSM_POSITION;
+    for (size_t i = 0; i < ids_to_find.size(); i++){
+        uint64_t key = static_cast<uint64_t>(ids_to_find[i]);
+        if (last_hit == NO_OSM_POSITION){
+            positions[i] = find(ids_to_find[i]);
+        }
+        else{
+            // Gallop away from the last hit in doubling steps until key is passed,
+            // then binary search the last step
+            size_t lo, hi;
+            if (key >= ids[last_hit]){
+                size_t step = 1;
+                lo = last_hit;
+                while (lo + step < ids.size() && ids[lo + step] < key){
+                    lo += step;
+                    step *= 2;
+                }
+                hi = std::min(ids.size(), lo + step + 1);
+            }
+            else{
+                size_t step = 1;
+                hi = last_hit;
+                while (hi >= step && ids[hi - step] > key){
+                    hi -= step;
+                    step *= 2;
+                }
+                lo = hi >= step ? hi - step : 0;
+            }
+
+            auto it = std::lower_bound(ids.begin() + lo, ids.begin() + hi, key);
+            positions[i] = (it != ids.begin() + hi && *it == key) ? uint32_t(it - ids.begin()) : NO_OSM_POSITION;
+        }
+
+        if (positions[i] != NO_OSM_POSITION){
+            last_hit = positions[i];
+        }
+    }
+}
+
+void osm_id_index::clear(){
+    ids.clear();
+    values.clear();
+}
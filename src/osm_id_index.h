@@ -0,0 +1,46 @@
+#ifndef OSM_ID_INDEX_H
+#define OSM_ID_INDEX_H
+
+#include <cstdint>
+#include <vector>
+#include "OSMDatabaseAPI.h"
+#include "mapped_vector.h"
+
+// Position returned when an id is not in the index
+constexpr uint32_t NO_OSM_POSITION = UINT32_MAX;
+
+// Compact OSMID -> uint32 table
+// Ids are kept in one sorted array with their values in a parallel array, so
+// an entry costs 12 bytes and building the table is a single sort. Lookups
+// use interpolation search (OSM ids are dense enough for it to land within a
+// few slots) and fall back to binary search on skewed ranges.
+// find returns the position of the id in the sorted array, so callers can
+// keep their own arrays parallel to the index (e.g. OSM_way_length)
+struct osm_id_index{
+    mapped_vector<uint64_t> ids;
+    mapped_vector<uint32_t> values;
+
+    // Builds the index from unsorted (id, value) pairs
+    // If an id appears more than once the first pair wins
+    void build(std::vector<std::pair<uint64_t, uint32_t>>& entries);
+
+    // Returns the position of id, or NO_OSM_POSITION if it isn't in the index
+    uint32_t find(OSMID id) const;
+
+    // Looks up every id in ids_to_find, writing their positions to positions
+    // Consecutive ids that sit close together in the index (like the members of
+    // a way) are found by galloping from the previous hit instead of a full search
+    void findBatch(const std::vector<OSMID>& ids_to_find, std::vector<uint32_t>& positions) const;
+
+    uint32_t value(uint32_t position) const{
+        return values[position];
+    }
+
+    size_t size() const{
+        return ids.size();
+    }
+
+    void clear();
+};
+
+#endif /* OSM_ID_INDEX_H */
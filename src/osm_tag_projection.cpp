@@ -0,0 +1,58 @@
+#include "osm_tag_projection.h"
+
+bool osm_tag_projection::keeps(std::string_view key, std::string_view value) const{
+    if (keep_all){
+        return true;
+    }
+
+    for (auto const& rule : rules){
+        bool key_match;
+        if (!rule.key.empty() && rule.key.back() == '*'){
+            std::string_view prefix(rule.key.data(), rule.key.size() - 1);
+            key_match = key.substr(0, prefix.size()) == prefix;
+        }
+        else{
+            key_match = key == rule.key;
+        }
+
+        if (key_match){
+            if (rule.values.empty()){
+                return true;
+            }
+            for (auto const& rule_value : rule.values){
+                if (value == rule_value){
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// FNV-1a over the keep_all flag and every key and value, with separators so
+// ("ab", "c") and ("a", "bc") hash differently
+uint64_t osm_tag_projection::signature() const{
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&](std::string_view str, char separator){
+        for (char c : str){
+            hash = (hash ^ uint8_t(c))*1099511628211ull;
+        }
+        hash = (hash ^ uint8_t(separator))*1099511628211ull;
+    };
+
+    add(keep_all ? "all" : "rules", ';');
+    for (auto const& rule : rules){
+        add(rule.key, '=');
+        for (auto const& value : rule.values){
+            add(value, ',');
+        }
+        add("", ';');
+    }
+    return hash;
+}
+
+void printTagProjectionReport(std::ostream& out, const osm_tag_projection_report& report){
+    out << "  Nodes: " << report.nodes_kept << " kept, " << report.nodes_dropped << " dropped" << std::endl;
+    out << "  Ways: " << report.ways_kept << " kept, " << report.ways_dropped << " dropped" << std::endl;
+    out << "  Tags: " << report.tags_kept << " kept, " << report.tags_dropped << " dropped" << std::endl;
+}
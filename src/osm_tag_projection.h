@@ -0,0 +1,45 @@
+#ifndef OSM_TAG_PROJECTION_H
+#define OSM_TAG_PROJECTION_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One key of a tag projection
+// A key ending in '*' matches every key that starts with the rest of it
+// (e.g. "diet:*"). An empty value list keeps every value of the key
+struct osm_tag_rule{
+    std::string key;
+    std::vector<std::string> values;
+};
+
+// Which OSM tags loadMap keeps in the tag stores
+// By default every tag is kept, which getOSMNodeTagValue/getOSMWayTagValue
+// need to answer queries on arbitrary keys. Programs that only read a known
+// set of tags (like the mapper) can set keep_all to false and list the tags
+// they need, and loadMap drops everything else while reading the OSM database
+struct osm_tag_projection{
+    bool keep_all = true;
+    std::vector<osm_tag_rule> rules;
+
+    bool keeps(std::string_view key, std::string_view value) const;
+
+    // Hash of the rules, so a map snapshot built with a different projection is rejected
+    uint64_t signature() const;
+};
+
+// What the projection kept and dropped during the last loadMap
+struct osm_tag_projection_report{
+    uint64_t nodes_kept = 0;
+    uint64_t nodes_dropped = 0;
+    uint64_t ways_kept = 0;
+    uint64_t ways_dropped = 0;
+    uint64_t tags_kept = 0;
+    uint64_t tags_dropped = 0;
+};
+
+void printTagProjectionReport(std::ostream& out, const osm_tag_projection_report& report);
+
+#endif /* OSM_TAG_PROJECTION_H */
@@ -0,0 +1,51 @@
+#include "osm_tag_store.h"
+
+void osm_tag_store::beginObject(OSMID id){
+    if (tag_offsets.empty()){
+        tag_offsets.push_back(0);
+    }
+    // The new slot's range starts where the last one ended
+    pending_objects.push_back(std::make_pair(static_cast<uint64_t>(id), uint32_t(tag_offsets.size() - 1)));
+    tag_offsets.push_back(tags.size());
+}
+
+void osm_tag_store::addTag(std::string_view key, std::string_view value){
+    tags.push_back({strings.intern(key), strings.intern(value)});
+    tag_offsets.back() = tags.size();
+}
+
+// A repeated id keeps its first slot, the repeat's tags end up in a range nothing points to
+void osm_tag_store::finishObjects(){
+    object_slot.build(pending_objects);
+    pending_objects.clear();
+    pending_objects.shrink_to_fit();
+}
+
+std::string_view osm_tag_store::getTagValue(OSMID id, std::string_view key) const{
+    uint32_t position = object_slot.find(id);
+    if (position == NO_OSM_POSITION){
+        return std::string_view();
+    }
+    uint32_t slot = object_slot.value(position);
+
+    // A key that was never interned can't be on any object
+    uint32_t key_id = strings.find(key);
+    if (key_id == NO_STRING){
+        return std::string_view();
+    }
+
+    for (uint32_t i = tag_offsets[slot]; i < tag_offsets[slot + 1]; i++){
+        if (tags[i].key == key_id){
+            return strings.get(tags[i].value);
+        }
+    }
+    return std::string_view();
+}
+
+void osm_tag_store::clear(){
+    strings.clear();
+    object_slot.clear();
+    pending_objects.clear();
+    tag_offsets.clear();
+    tags.clear();
+}
@@ -0,0 +1,50 @@
+#ifndef OSM_TAG_STORE_H
+#define OSM_TAG_STORE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "OSMDatabaseAPI.h"
+#include "osm_id_index.h"
+#include "string_pool.h"
+#include "mapped_vector.h"
+
+// One tag, as ids into the store's string pool
+struct osm_tag{
+    uint32_t key;
+    uint32_t value;
+};
+
+// Columnar storage for the tags of OSM nodes or ways
+// Keys and values are interned once in a shared string pool, and the tags of 
+// all objects sit back to back in one flat array. Object slot i owns
+// tags[tag_offsets[i]] to tags[tag_offsets[i + 1]]
+// Lookups return views into the pool and never allocate
+struct osm_tag_store{
+    string_pool strings;
+    // OSMID -> object slot, built by finishObjects
+    osm_id_index object_slot;
+    mapped_vector<uint32_t> tag_offsets;
+    mapped_vector<osm_tag> tags;
+    // Ids of the objects added since the last finishObjects, in slot order
+    std::vector<std::pair<uint64_t, uint32_t>> pending_objects;
+
+    // Adds an object and its tags. Objects must be added one at a time:
+    // beginObject, addTag for each tag, then the next beginObject
+    // Objects can't be looked up until finishObjects is called
+    void beginObject(OSMID id);
+    void addTag(std::string_view key, std::string_view value);
+    void finishObjects();
+
+    // Returns the value of key on the given object, or an empty view if the 
+    // object doesn't exist or doesn't have the key
+    std::string_view getTagValue(OSMID id, std::string_view key) const;
+
+    size_t numObjects() const{
+        return object_slot.size();
+    }
+
+    void clear();
+};
+
+#endif /* OSM_TAG_STORE_H */
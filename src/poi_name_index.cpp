@@ -0,0 +1,53 @@
+#include "poi_name_index.h"
+#include <algorithm>
+
+void poi_name_index::build(const std::vector<std::string_view>& poi_names, const std::vector<LatLon>& positions){
+    clear();
+
+    // Group the POIs by name id, keeping POI order within a name
+    std::vector<std::pair<uint32_t, POIIdx>> named(poi_names.size());
+    for (size_t i = 0; i < poi_names.size(); i++){
+        named[i] = std::make_pair(names.intern(poi_names[i]), POIIdx(i));
+    }
+    std::sort(named.begin(), named.end());
+
+    bucket_offsets.assign(names.size() + 1, 0);
+    pois.resize(named.size());
+    std::vector<LatLon> bucket_positions(named.size());
+    for (size_t i = 0; i < named.size(); i++){
+        bucket_offsets[named[i].first + 1]++;
+        pois[i] = named[i].second;
+        bucket_positions[i] = positions[named[i].second];
+    }
+    for (size_t n = 0; n < names.size(); n++){
+        bucket_offsets[n + 1] += bucket_offsets[n];
+    }
+
+    trees.buildRanges(bucket_positions, bucket_offsets);
+}
+
+POIIdx poi_name_index::closest(LatLon position, std::string_view name) const{
+    uint32_t name_id = names.find(name);
+    if (name_id == NO_STRING){
+        return -1;
+    }
+    // Tree ids are positions in pois, which is sorted by POI id within the bucket,
+    // so the tree's tie break on smaller ids also picks the smaller POI id
+    int found = trees.nearestInRange(position, bucket_offsets[name_id], bucket_offsets[name_id + 1]);
+    return found < 0 ? -1 : pois[found];
+}
+
+size_t poi_name_index::count(std::string_view name) const{
+    uint32_t name_id = names.find(name);
+    if (name_id == NO_STRING){
+        return 0;
+    }
+    return bucket_offsets[name_id + 1] - bucket_offsets[name_id];
+}
+
+void poi_name_index::clear(){
+    names.clear();
+    bucket_offsets.clear();
+    pois.clear();
+    trees.clear();
+}
@@ -0,0 +1,35 @@
+#ifndef POI_NAME_INDEX_H
+#define POI_NAME_INDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "LatLon.h"
+#include "StreetsDatabaseAPI.h"
+#include "latlon_kd_tree.h"
+#include "string_pool.h"
+#include "mapped_vector.h"
+
+// POIs bucketed by name, with a KD-tree per bucket
+// Name n (an id in names) owns pois[bucket_offsets[n]] to pois[bucket_offsets[n + 1]],
+// in increasing POI order, and trees is a forest with one tree over each bucket's range
+struct poi_name_index{
+    string_pool names;
+    mapped_vector<uint32_t> bucket_offsets;
+    mapped_vector<POIIdx> pois;
+    latlon_kd_tree trees;
+
+    // Builds the index from the name and position of every POI
+    void build(const std::vector<std::string_view>& poi_names, const std::vector<LatLon>& positions);
+
+    // Returns the closest POI with exactly this name, or -1 if there is none
+    // Ties go to the smaller POI id
+    POIIdx closest(LatLon position, std::string_view name) const;
+
+    // Returns how many POIs have this name
+    size_t count(std::string_view name) const;
+
+    void clear();
+};
+
+#endif /* POI_NAME_INDEX_H */
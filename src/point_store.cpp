@@ -0,0 +1,25 @@
+#include "point_store.h"
+
+void point_store::resize(size_t num_points){
+    x.resize(num_points);
+    y.resize(num_points);
+    name_ids.resize(num_points);
+    highlight.assign((num_points + 63)/64, 0);
+}
+
+void point_store::setHighlight(size_t i, bool on){
+    if (on){
+        highlight[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+    else{
+        highlight[i >> 6] &= ~(uint64_t(1) << (i & 63));
+    }
+}
+
+void point_store::clear(){
+    x.clear();
+    y.clear();
+    name_ids.clear();
+    names.clear();
+    highlight.clear();
+}
@@ -0,0 +1,61 @@
+#ifndef POINT_STORE_H
+#define POINT_STORE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "ezgl/point.hpp"
+#include "string_pool.h"
+#include "projection.h"
+#include "mapped_vector.h"
+
+// Positions, names and highlight flags of a set of map points (intersections
+// or POIs), one array per field so a pass over the coordinates doesn't drag
+// the names through the cache. Point i is stored at (x[i], y[i]), pos(i) is
+// its projected xy (see geometry_coord in projection.h), it is called
+// names.get(name_ids[i]) and is highlighted if bit i of highlight is set.
+// Equal names are stored once
+struct point_store{
+    mapped_vector<geometry_coord> x;
+    mapped_vector<geometry_coord> y;
+    mapped_vector<uint32_t> name_ids;
+    string_pool names;
+    std::vector<uint64_t> highlight;
+
+    size_t size() const{
+        return x.size();
+    }
+
+    // Sizes the arrays for num_points points, all unnamed and not highlighted
+    void resize(size_t num_points);
+
+    ezgl::point2d pos(size_t i) const{
+        return projection.load(x[i], y[i]);
+    }
+
+    // Valid until the store is cleared, and NUL terminated (see string_pool)
+    std::string_view name(size_t i) const{
+        return names.get(name_ids[i]);
+    }
+
+    bool highlighted(size_t i) const{
+        return (highlight[i >> 6] >> (i & 63)) & 1;
+    }
+
+    void setHighlight(size_t i, bool on);
+
+    // Calls f(i) for every highlighted point in increasing order, skipping
+    // 64 points at a time where none are highlighted
+    template <typename F>
+    void forEachHighlighted(F f) const{
+        for (size_t word = 0; word < highlight.size(); word++){
+            for (uint64_t bits = highlight[word]; bits != 0; bits &= bits - 1){
+                f(word*64 + __builtin_ctzll(bits));
+            }
+        }
+    }
+
+    void clear();
+};
+
+#endif /* POINT_STORE_H */
@@ -0,0 +1,37 @@
+#include "projection.h"
+#include <cmath>
+#include "StreetsDatabaseAPI.h"
+
+map_projection::map_projection(double min_lat, double max_lat, double min_lon, double max_lon){
+    avg_lat = (min_lat + max_lat)/2;
+    y_scale = kDegreeToRadian*kEarthRadiusInMeters;
+    x_scale = y_scale*std::cos(avg_lat*kDegreeToRadian);
+    origin_x = x((min_lon + max_lon)/2);
+    origin_y = y(avg_lat);
+}
+
+void map_projection::toXY(const LatLon* positions, size_t num_points, double* xs, double* ys) const{
+    double scale_x = x_scale, scale_y = y_scale;
+    #pragma omp simd
+    for (size_t i = 0; i < num_points; i++){
+        xs[i] = positions[i].longitude()*scale_x;
+        ys[i] = positions[i].latitude()*scale_y;
+    }
+}
+
+void map_projection::storeXY(const LatLon* positions, size_t num_points, geometry_coord* xs, geometry_coord* ys) const{
+    #pragma omp simd
+    for (size_t i = 0; i < num_points; i++){
+        xs[i] = storeX(positions[i].longitude()*x_scale);
+        ys[i] = storeY(positions[i].latitude()*y_scale);
+    }
+}
+
+void map_projection::toLatLon(const double* xs, const double* ys, size_t num_points, double* lats, double* lons) const{
+    double scale_x = x_scale, scale_y = y_scale;
+    #pragma omp simd
+    for (size_t i = 0; i < num_points; i++){
+        lons[i] = xs[i]/scale_x;
+        lats[i] = ys[i]/scale_y;
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef PROJECTION_H
+#define PROJECTION_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "LatLon.h"
+#include "ezgl/point.hpp"
+
+// Stored geometry coordinates
+//
+// Projected geometry (intersection and POI positions, segment polylines and
+// feature outlines) is stored as geometry_coord. By default that is the
+// double xy itself. Built with -DMAPPER_QUANTIZED_GEOMETRY it is an int32
+// number of 1/GEOMETRY_UNITS_PER_METER steps from the projected centre of the
+// map, which halves the stored geometry and fits twice as many vertices in a
+// cache line. Stored coordinates are dequantized (map_projection::load) when
+// they are drawn or queried. An int32 reaches 21000 km at 1 cm, more than any map spans
+#ifdef MAPPER_QUANTIZED_GEOMETRY
+typedef int32_t geometry_coord;
+#define GEOMETRY_UNITS_PER_METER 100
+#else
+typedef double geometry_coord;
+#endif
+
+struct geometry_point{
+    geometry_coord x;
+    geometry_coord y;
+};
+
+// Equirectangular projection of the current map to the xy drawn on the
+// canvas, in meters: x scales longitude by the cosine of the map's average
+// latitude and y is latitude. The cosine is computed once when the
+// projection is set, and every conversion takes and returns doubles, so
+// lon -> x -> lon round trips to within a rounding error
+struct map_projection{
+    double avg_lat = 0;
+    // Meters per degree of longitude and of latitude
+    double x_scale = 0;
+    double y_scale = 0;
+    // Projected centre of the map, what quantized coordinates count from
+    double origin_x = 0;
+    double origin_y = 0;
+
+    map_projection(){}
+
+    // Projection of a map with the given bounds
+    map_projection(double min_lat, double max_lat, double min_lon, double max_lon);
+
+    double x(double lon) const{
+        return lon*x_scale;
+    }
+
+    double y(double lat) const{
+        return lat*y_scale;
+    }
+
+    double lon(double x) const{
+        return x/x_scale;
+    }
+
+    double lat(double y) const{
+        return y/y_scale;
+    }
+
+    // xy <-> stored coordinates, the identity unless MAPPER_QUANTIZED_GEOMETRY
+#ifdef MAPPER_QUANTIZED_GEOMETRY
+    geometry_coord storeX(double x) const{
+        return geometry_coord(std::lround((x - origin_x)*GEOMETRY_UNITS_PER_METER));
+    }
+
+    geometry_coord storeY(double y) const{
+        return geometry_coord(std::lround((y - origin_y)*GEOMETRY_UNITS_PER_METER));
+    }
+
+    double loadX(geometry_coord x) const{
+        return origin_x + double(x)/GEOMETRY_UNITS_PER_METER;
+    }
+
+    double loadY(geometry_coord y) const{
+        return origin_y + double(y)/GEOMETRY_UNITS_PER_METER;
+    }
+#else
+    geometry_coord storeX(double x) const{
+        return x;
+    }
+
+    geometry_coord storeY(double y) const{
+        return y;
+    }
+
+    double loadX(geometry_coord x) const{
+        return x;
+    }
+
+    double loadY(geometry_coord y) const{
+        return y;
+    }
+#endif
+
+    // Projects and stores position
+    geometry_point store(LatLon position) const{
+        return geometry_point{storeX(x(position.longitude())), storeY(y(position.latitude()))};
+    }
+
+    ezgl::point2d load(geometry_coord x, geometry_coord y) const{
+        return ezgl::point2d(loadX(x), loadY(y));
+    }
+
+    ezgl::point2d load(geometry_point point) const{
+        return load(point.x, point.y);
+    }
+
+    // Projects num_points positions into xs/ys
+    void toXY(const LatLon* positions, size_t num_points, double* xs, double* ys) const;
+
+    // Projects and stores num_points positions into xs/ys
+    void storeXY(const LatLon* positions, size_t num_points, geometry_coord* xs, geometry_coord* ys) const;
+
+    // Unprojects num_points xy points into lats/lons
+    void toLatLon(const double* xs, const double* ys, size_t num_points, double* lats, double* lons) const;
+};
+
+// xy projection of the current map, set once its bounds are known
+extern map_projection projection;
+
+#endif /* PROJECTION_H */
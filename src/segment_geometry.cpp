@@ -0,0 +1,50 @@
+#include "segment_geometry.h"
+
+void segment_geometry_store::pack(){
+    if (!packed.empty() || polylines.size() == 0){
+        return;
+    }
+    std::vector<double> xs(polylines.values.size()), ys(polylines.values.size());
+    for (size_t i = 0; i < polylines.values.size(); i++){
+        ezgl::point2d point = projection.load(polylines.values[i]);
+        xs[i] = point.x;
+        ys[i] = point.y;
+    }
+    packed.build(polylines.offsets, xs.data(), ys.data(), projection.origin_x, projection.origin_y);
+    polylines = csr_table<geometry_point>();
+}
+
+void segment_geometry_store::unpack(){
+    if (packed.empty()){
+        return;
+    }
+    polylines.beginCount(packed.size());
+    for (size_t s = 0; s < packed.size(); s++){
+        polylines.count(s, packed.item_counts[s]);
+    }
+    polylines.endCount();
+
+    // A block at a time, pushing each point to the segment it belongs to
+    csr_table<uint32_t> block_items;
+    block_items.beginCount(packed.numBlocks());
+    for (size_t s = 0; s < packed.size(); s++){
+        block_items.count(packed.item_blocks[s]);
+    }
+    block_items.endCount();
+    for (size_t s = 0; s < packed.size(); s++){
+        block_items.push(packed.item_blocks[s], s);
+    }
+    block_items.endPush();
+    std::vector<ezgl::point2d> points;
+    for (size_t b = 0; b < packed.numBlocks(); b++){
+        packed.decodeBlock(b, points);
+        for (uint32_t s : block_items[b]){
+            for (uint32_t p = 0; p < packed.item_counts[s]; p++){
+                ezgl::point2d point = points[packed.item_firsts[s] + p];
+                polylines.push(s, geometry_point{projection.storeX(point.x), projection.storeY(point.y)});
+            }
+        }
+    }
+    polylines.endPush();
+    packed.clear();
+}
@@ -0,0 +1,46 @@
+#ifndef SEGMENT_GEOMETRY_H
+#define SEGMENT_GEOMETRY_H
+
+#include <vector>
+#include "ezgl/point.hpp"
+#include "csr_table.h"
+#include "projection.h"
+#include "geometry_blocks.h"
+#include "mapped_vector.h"
+
+// Shape of every street segment, built once in loadMap so drawing and the
+// geometry queries don't go back to the streets database per curve point
+//
+// polylines[s] is the stored polyline of segment s (see geometry_coord in
+// projection.h): its from intersection, its curve points, then its to
+// intersection, all in one flat array. Once packed the polylines are in
+// packed instead (see geometry_blocks.h) and polylines is empty. lengths[s]
+// is the segment length in meters (findStreetSegmentLength).
+// from_bearings[s] is the direction (radians, counter-clockwise from east) of
+// the first piece of the segment leaving its from intersection, and
+// to_bearings[s] the direction of the last piece leaving its to intersection
+struct segment_geometry_store{
+    csr_table<geometry_point> polylines;
+    geometry_blocks packed;
+    mapped_vector<double> lengths;
+    mapped_vector<double> from_bearings;
+    mapped_vector<double> to_bearings;
+
+    size_t size() const{
+        return lengths.size();
+    }
+
+    // Moves the polylines into packed, or back out of it (to within a centimetre)
+    void pack();
+    void unpack();
+
+    void clear(){
+        polylines.clear();
+        packed.clear();
+        lengths.clear();
+        from_bearings.clear();
+        to_bearings.clear();
+    }
+};
+
+#endif /* SEGMENT_GEOMETRY_H */
@@ -0,0 +1,133 @@
+#include "street_crossing_index.h"
+#include <algorithm>
+
+// Helper Function Prototypes
+uint64_t streetPairKey(StreetIdx street1, StreetIdx street2);
+size_t streetPairSlot(uint64_t key, size_t num_slots);
+
+void street_crossing_index::build(const csr_table<StreetIdx>& streets_of_intersection, int num_streets){
+    clear();
+
+    // Every pair of distinct streets at every intersection, visited in intersection order
+    std::vector<std::pair<uint64_t, IntersectionIdx>> pairs;
+    std::vector<StreetIdx> streets;
+    for (size_t i = 0; i < streets_of_intersection.size(); i++){
+        streets.assign(streets_of_intersection[i].begin(), streets_of_intersection[i].end());
+        std::sort(streets.begin(), streets.end());
+        streets.erase(std::unique(streets.begin(), streets.end()), streets.end());
+        for (size_t a = 0; a < streets.size(); a++){
+            for (size_t b = a + 1; b < streets.size(); b++){
+                pairs.push_back(std::make_pair(streetPairKey(streets[a], streets[b]), IntersectionIdx(i)));
+            }
+        }
+    }
+    // Stable, so each pair's intersections stay in increasing order
+    std::stable_sort(pairs.begin(), pairs.end(), [](const std::pair<uint64_t, IntersectionIdx>& x, const std::pair<uint64_t, IntersectionIdx>& y){
+        return x.first < y.first;
+    });
+
+    intersections.reserve(pairs.size());
+    for (size_t i = 0; i < pairs.size(); i++){
+        if (entry_keys.empty() || entry_keys.back() != pairs[i].first){
+            entry_keys.push_back(pairs[i].first);
+            entry_offsets.push_back(intersections.size());
+        }
+        intersections.push_back(pairs[i].second);
+    }
+    entry_offsets.push_back(intersections.size());
+
+    // Hash table at most half full
+    size_t num_slots = 2;
+    while (num_slots < 2*entry_keys.size()){
+        num_slots *= 2;
+    }
+    slots.assign(num_slots, 0);
+    for (size_t e = 0; e < entry_keys.size(); e++){
+        size_t slot = streetPairSlot(entry_keys[e], num_slots);
+        while (slots[slot] != 0){
+            slot = (slot + 1) & (num_slots - 1);
+        }
+        slots[slot] = e + 1;
+    }
+
+    // Entries of each street, counted then filled
+    partner_offsets.assign(num_streets + 1, 0);
+    for (uint64_t key : entry_keys){
+        partner_offsets[(key >> 32) + 1]++;
+        partner_offsets[(key & 0xFFFFFFFF) + 1]++;
+    }
+    for (int s = 0; s < num_streets; s++){
+        partner_offsets[s + 1] += partner_offsets[s];
+    }
+    partners.resize(2*entry_keys.size());
+    std::vector<uint32_t> fill(partner_offsets.begin(), partner_offsets.end() - 1);
+    for (size_t e = 0; e < entry_keys.size(); e++){
+        partners[fill[entry_keys[e] >> 32]++] = e;
+        partners[fill[entry_keys[e] & 0xFFFFFFFF]++] = e;
+    }
+}
+
+array_view<IntersectionIdx> street_crossing_index::find(StreetIdx street1, StreetIdx street2) const{
+    if (street1 == street2 || slots.empty()){
+        return array_view<IntersectionIdx>();
+    }
+    uint64_t key = streetPairKey(street1, street2);
+    size_t slot = streetPairSlot(key, slots.size());
+    while (slots[slot] != 0){
+        uint32_t e = slots[slot] - 1;
+        if (entry_keys[e] == key){
+            return array_view<IntersectionIdx>(intersections.data() + entry_offsets[e], entry_offsets[e + 1] - entry_offsets[e]);
+        }
+        slot = (slot + 1) & (slots.size() - 1);
+    }
+    return array_view<IntersectionIdx>();
+}
+
+std::vector<street_crossing> street_crossing_index::findAll(array_view<StreetIdx> streets1, array_view<StreetIdx> streets2) const{
+    std::vector<street_crossing> crossings;
+    if (partner_offsets.empty()){
+        return crossings;
+    }
+
+    std::vector<bool> in_streets2(partner_offsets.size() - 1, false);
+    for (StreetIdx street : streets2){
+        in_streets2[street] = true;
+    }
+
+    // Walk the crossings of each street in streets1 and keep the ones with a street of streets2
+    for (StreetIdx street : streets1){
+        for (uint32_t p = partner_offsets[street]; p < partner_offsets[street + 1]; p++){
+            uint32_t e = partners[p];
+            StreetIdx low = entry_keys[e] >> 32;
+            StreetIdx high = entry_keys[e] & 0xFFFFFFFF;
+            StreetIdx other = low == street ? high : low;
+            if (in_streets2[other]){
+                array_view<IntersectionIdx> crossing(intersections.data() + entry_offsets[e], entry_offsets[e + 1] - entry_offsets[e]);
+                crossings.push_back({street, other, crossing});
+            }
+        }
+    }
+    return crossings;
+}
+
+void street_crossing_index::clear(){
+    entry_keys.clear();
+    entry_offsets.clear();
+    intersections.clear();
+    slots.clear();
+    partner_offsets.clear();
+    partners.clear();
+}
+
+// ------------- Helper Functions -------------
+
+uint64_t streetPairKey(StreetIdx street1, StreetIdx street2){
+    uint64_t low = std::min(street1, street2);
+    uint64_t high = std::max(street1, street2);
+    return (low << 32) | high;
+}
+
+// Fibonacci hashing, num_slots is a power of two
+size_t streetPairSlot(uint64_t key, size_t num_slots){
+    return (key*11400714819323198485ull) >> (64 - __builtin_ctzll(num_slots)) & (num_slots - 1);
+}
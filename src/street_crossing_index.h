@@ -0,0 +1,48 @@
+#ifndef STREET_CROSSING_INDEX_H
+#define STREET_CROSSING_INDEX_H
+
+#include <cstdint>
+#include <vector>
+#include "StreetsDatabaseAPI.h"
+#include "array_view.h"
+#include "csr_table.h"
+#include "mapped_vector.h"
+
+// One pair of streets and the intersections where they cross
+struct street_crossing{
+    StreetIdx street1;
+    StreetIdx street2;
+    array_view<IntersectionIdx> intersections;
+};
+
+// Precomputed street pair -> crossing intersections
+// Every pair of different streets that meet at an intersection gets an entry
+// keyed by (smaller street << 32 | larger street). Entry e owns
+// intersections[entry_offsets[e]] to intersections[entry_offsets[e + 1]], in
+// increasing order. An open addressing hash table (slots, entry + 1, 0 = empty)
+// finds the entry of a pair in O(1) expected time, and partners lists the
+// entries of every street (street s owns partners[partner_offsets[s]] to
+// partners[partner_offsets[s + 1]]) for the batch lookup
+struct street_crossing_index{
+    mapped_vector<uint64_t> entry_keys;
+    mapped_vector<uint32_t> entry_offsets;
+    mapped_vector<IntersectionIdx> intersections;
+    mapped_vector<uint32_t> slots;
+    mapped_vector<uint32_t> partner_offsets;
+    mapped_vector<uint32_t> partners;
+
+    // Builds the index from the streets that meet at each intersection
+    // streets_of_intersection[i] may list a street more than once
+    void build(const csr_table<StreetIdx>& streets_of_intersection, int num_streets);
+
+    // Returns the intersections where two different streets cross
+    array_view<IntersectionIdx> find(StreetIdx street1, StreetIdx street2) const;
+
+    // Returns every crossing between a street of streets1 and a different street
+    // of streets2, in streets1 order
+    std::vector<street_crossing> findAll(array_view<StreetIdx> streets1, array_view<StreetIdx> streets2) const;
+
+    void clear();
+};
+
+#endif /* STREET_CROSSING_INDEX_H */
@@ -0,0 +1,151 @@
+#include "street_fuzzy_index.h"
+#include <algorithm>
+#include <chrono>
+
+// How often (in candidates) fuzzyFind checks its latency budget
+#define FUZZY_BUDGET_CHECK_INTERVAL 32
+
+// Helper Function Prototypes
+void nameTrigrams(std::string_view name, std::vector<uint32_t>& grams);
+int prefixEditDistance(std::string_view query, std::string_view name, int max_distance);
+
+void street_fuzzy_index::build(const street_prefix_index& names){
+    clear();
+
+    std::vector<std::pair<uint32_t, uint32_t>> gram_names;
+    std::vector<uint32_t> grams;
+    for (size_t i = 0; i < names.numNames(); i++){
+        nameTrigrams(names.name(i), grams);
+        for (uint32_t gram : grams){
+            gram_names.push_back(std::make_pair(gram, uint32_t(i)));
+        }
+    }
+    // Names are visited in order, so sorting on the trigram keeps every posting list sorted
+    std::stable_sort(gram_names.begin(), gram_names.end(), [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b){
+        return a.first < b.first;
+    });
+
+    postings.reserve(gram_names.size());
+    for (size_t i = 0; i < gram_names.size(); i++){
+        if (gram_keys.empty() || gram_keys.back() != gram_names[i].first){
+            gram_keys.push_back(gram_names[i].first);
+            gram_offsets.push_back(postings.size());
+        }
+        postings.push_back(gram_names[i].second);
+    }
+    gram_offsets.push_back(postings.size());
+}
+
+std::vector<fuzzy_street_match> street_fuzzy_index::fuzzyFind(const street_prefix_index& names, std::string_view query, size_t max_results, double budget_us) const{
+    std::vector<fuzzy_street_match> matches;
+    if (query.empty() || gram_keys.empty()){
+        return matches;
+    }
+    auto const start = std::chrono::steady_clock::now();
+
+    // Count the trigrams each name shares with the query by merging the query's posting lists
+    std::vector<uint32_t> grams;
+    nameTrigrams(query, grams);
+    std::vector<uint16_t> shared(names.numNames(), 0);
+    std::vector<uint32_t> touched;
+    for (uint32_t gram : grams){
+        auto it = std::lower_bound(gram_keys.begin(), gram_keys.end(), gram);
+        if (it == gram_keys.end() || *it != gram){
+            continue;
+        }
+        size_t g = it - gram_keys.begin();
+        for (uint32_t p = gram_offsets[g]; p < gram_offsets[g + 1]; p++){
+            if (shared[postings[p]]++ == 0){
+                touched.push_back(postings[p]);
+            }
+        }
+    }
+
+    // Each edit destroys at most 3 trigrams, so a name within MAX_FUZZY_DISTANCE
+    // edits still shares all but 3*MAX_FUZZY_DISTANCE of them. Short queries
+    // have too few trigrams for that bound, so they need at least one in common
+    int min_shared = std::max(1, int(grams.size()) - 3*MAX_FUZZY_DISTANCE);
+    std::vector<uint32_t> candidates;
+    for (uint32_t name : touched){
+        if (shared[name] >= min_shared){
+            candidates.push_back(name);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b){
+        return shared[a] != shared[b] ? shared[a] > shared[b] : a < b;
+    });
+
+    // Verify best candidates first until the budget runs out
+    std::vector<std::pair<int, uint32_t>> found;
+    for (size_t i = 0; i < candidates.size(); i++){
+        if (i % FUZZY_BUDGET_CHECK_INTERVAL == 0 && i > 0){
+            double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            if (elapsed > budget_us){
+                break;
+            }
+        }
+        int distance = prefixEditDistance(query, names.name(candidates[i]), MAX_FUZZY_DISTANCE);
+        if (distance <= MAX_FUZZY_DISTANCE){
+            found.push_back(std::make_pair(distance, uint32_t(i)));
+        }
+    }
+    // Candidate order already ranks by shared trigrams, so ties keep it
+    std::stable_sort(found.begin(), found.end(), [](const std::pair<int, uint32_t>& a, const std::pair<int, uint32_t>& b){
+        return a.first < b.first;
+    });
+
+    for (size_t i = 0; i < found.size() && matches.size() < max_results; i++){
+        uint32_t name = candidates[found[i].second];
+        for (uint32_t s = names.street_offsets[name]; s < names.street_offsets[name + 1] && matches.size() < max_results; s++){
+            matches.push_back({names.street_ids[s], found[i].first});
+        }
+    }
+    return matches;
+}
+
+void street_fuzzy_index::clear(){
+    gram_keys.clear();
+    gram_offsets.clear();
+    postings.clear();
+}
+
+// ------------- Helper Functions -------------
+
+// Distinct trigrams of name, padded with two leading zero bytes so the start of
+// the name counts for more. Each trigram is packed into the low 24 bits of a key
+void nameTrigrams(std::string_view name, std::vector<uint32_t>& grams){
+    grams.clear();
+    uint32_t gram = 0;
+    for (char c : name){
+        gram = ((gram << 8) | (unsigned char) c) & 0xFFFFFF;
+        grams.push_back(gram);
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+}
+
+// Edit distance between query and the closest prefix of name
+// Returns max_distance + 1 as soon as every prefix is known to be further than max_distance
+int prefixEditDistance(std::string_view query, std::string_view name, int max_distance){
+    // Prefixes longer than the query + max_distance can't be close enough
+    size_t cols = std::min(name.size(), query.size() + max_distance) + 1;
+    std::vector<int> prev(cols), curr(cols);
+    for (size_t j = 0; j < cols; j++){
+        prev[j] = j;
+    }
+
+    for (size_t i = 1; i <= query.size(); i++){
+        curr[0] = i;
+        int row_min = curr[0];
+        for (size_t j = 1; j < cols; j++){
+            int substitute = prev[j - 1] + (query[i - 1] != name[j - 1]);
+            curr[j] = std::min({prev[j] + 1, curr[j - 1] + 1, substitute});
+            row_min = std::min(row_min, curr[j]);
+        }
+        if (row_min > max_distance){
+            return max_distance + 1;
+        }
+        std::swap(prev, curr);
+    }
+    return *std::min_element(prev.begin(), prev.end());
+}
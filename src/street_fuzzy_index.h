@@ -0,0 +1,44 @@
+#ifndef STREET_FUZZY_INDEX_H
+#define STREET_FUZZY_INDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "StreetsDatabaseAPI.h"
+#include "street_prefix_index.h"
+#include "mapped_vector.h"
+
+// Largest edit distance fuzzyFind will match
+#define MAX_FUZZY_DISTANCE 2
+
+// One fuzzy match: a street and the edit distance between the query and the
+// closest prefix of the street's normalized name
+struct fuzzy_street_match{
+    StreetIdx street;
+    int distance;
+};
+
+// Trigram inverted index over the distinct names of a street_prefix_index
+// Every name is padded with two leading zero bytes and split into trigrams,
+// and each trigram keeps the sorted list of names it occurs in. A query only
+// merges the posting lists of its own trigrams, so names sharing nothing with
+// the query are never looked at.
+// Trigram gram_keys[i] occurs in names postings[gram_offsets[i]] to postings[gram_offsets[i + 1]]
+struct street_fuzzy_index{
+    mapped_vector<uint32_t> gram_keys;
+    mapped_vector<uint32_t> gram_offsets;
+    mapped_vector<uint32_t> postings;
+
+    void build(const street_prefix_index& names);
+
+    // Returns streets whose normalized name has a prefix within MAX_FUZZY_DISTANCE
+    // edits of the normalized query, best first (fewest edits, then most shared
+    // trigrams), at most max_results of them
+    // Candidates are checked best first and the search stops after budget_us
+    // microseconds, so a slow query returns the best matches found so far
+    std::vector<fuzzy_street_match> fuzzyFind(const street_prefix_index& names, std::string_view query, size_t max_results, double budget_us) const;
+
+    void clear();
+};
+
+#endif /* STREET_FUZZY_INDEX_H */
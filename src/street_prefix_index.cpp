@@ -0,0 +1,77 @@
+#include "street_prefix_index.h"
+#include <algorithm>
+
+void street_prefix_index::build(std::vector<std::pair<std::string, StreetIdx>>& names){
+    std::sort(names.begin(), names.end());
+
+    clear();
+    name_offsets.push_back(0);
+    street_offsets.push_back(0);
+    street_ids.reserve(names.size());
+    for (size_t i = 0; i < names.size(); i++){
+        // A new name starts a new entry, repeats just add their street to the last one
+        if (i == 0 || names[i].first != names[i - 1].first){
+            if (i > 0){
+                name_offsets.push_back(chars.size());
+                street_offsets.push_back(street_ids.size());
+            }
+            chars.insert(chars.end(), names[i].first.begin(), names[i].first.end());
+        }
+        street_ids.push_back(names[i].second);
+    }
+    if (!names.empty()){
+        name_offsets.push_back(chars.size());
+        street_offsets.push_back(street_ids.size());
+    }
+}
+
+array_view<StreetIdx> street_prefix_index::find(std::string_view prefix) const{
+    size_t num_names = numNames();
+    if (prefix.empty() || num_names == 0){
+        return array_view<StreetIdx>();
+    }
+
+    // First name that is >= prefix
+    size_t lo = 0;
+    size_t hi = num_names;
+    while (lo < hi){
+        size_t mid = lo + (hi - lo)/2;
+        if (name(mid) < prefix){
+            lo = mid + 1;
+        }
+        else{
+            hi = mid;
+        }
+    }
+    size_t first = lo;
+
+    // First name after that which doesn't start with prefix
+    hi = num_names;
+    while (lo < hi){
+        size_t mid = lo + (hi - lo)/2;
+        if (name(mid).substr(0, prefix.size()) == prefix){
+            lo = mid + 1;
+        }
+        else{
+            hi = mid;
+        }
+    }
+    size_t last = lo;
+
+    return array_view<StreetIdx>(street_ids.data() + street_offsets[first], street_offsets[last] - street_offsets[first]);
+}
+
+array_view<StreetIdx> street_prefix_index::findPage(std::string_view prefix, size_t offset, size_t limit) const{
+    array_view<StreetIdx> matches = find(prefix);
+    if (offset >= matches.size()){
+        return array_view<StreetIdx>();
+    }
+    return array_view<StreetIdx>(matches.data() + offset, std::min(limit, matches.size() - offset));
+}
+
+void street_prefix_index::clear(){
+    chars.clear();
+    name_offsets.clear();
+    street_offsets.clear();
+    street_ids.clear();
+}
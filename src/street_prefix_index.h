@@ -0,0 +1,50 @@
+#ifndef STREET_PREFIX_INDEX_H
+#define STREET_PREFIX_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "StreetsDatabaseAPI.h"
+#include "array_view.h"
+#include "mapped_vector.h"
+
+// Sorted array index from normalized street names to street ids
+// Each distinct name is stored once, sorted bytewise (which for UTF-8 is code
+// point order, so any first character works). The street ids are laid out in
+// the same name order, so every street whose name starts with a given prefix
+// sits in one contiguous range of street_ids, and a lookup is two binary
+// searches that return a view of that range.
+//
+// Name i is chars[name_offsets[i]] to chars[name_offsets[i + 1]], and its
+// streets are street_ids[street_offsets[i]] to street_ids[street_offsets[i + 1]]
+struct street_prefix_index{
+    mapped_vector<char> chars;
+    mapped_vector<uint32_t> name_offsets;
+    mapped_vector<uint32_t> street_offsets;
+    mapped_vector<StreetIdx> street_ids;
+
+    // Builds the index from (normalized name, street id) pairs, in any order
+    // Streets that share a name are kept in increasing id order
+    void build(std::vector<std::pair<std::string, StreetIdx>>& names);
+
+    // Returns the ids of all streets whose normalized name starts with prefix
+    // An empty prefix matches nothing
+    array_view<StreetIdx> find(std::string_view prefix) const;
+
+    // Same as find, but only returns up to limit ids starting at the offset-th match
+    array_view<StreetIdx> findPage(std::string_view prefix, size_t offset, size_t limit) const;
+
+    std::string_view name(size_t i) const{
+        return std::string_view(chars.data() + name_offsets[i], name_offsets[i + 1] - name_offsets[i]);
+    }
+
+    size_t numNames() const{
+        return name_offsets.empty() ? 0 : name_offsets.size() - 1;
+    }
+
+    void clear();
+};
+
+#endif /* STREET_PREFIX_INDEX_H */
@@ -0,0 +1,117 @@
+#include "string_pool.h"
+#include <algorithm>
+#include <cstring>
+
+// First chunk of a pool's arena, later chunks grow geometrically
+#define STRING_POOL_FIRST_CHUNK 4096
+// Smallest hash table
+#define STRING_POOL_MIN_SLOTS 16
+
+// Helper Function Prototypes
+void insertSlot(mapped_vector<uint32_t>& slots, uint64_t hash, uint32_t id);
+
+uint32_t string_pool::intern(std::string_view str){
+    uint32_t id = find(str);
+    if (id != NO_STRING){
+        return id;
+    }
+
+    if (!memory){
+        memory = std::make_unique<map_arena>(mapMemory(), false, STRING_POOL_FIRST_CHUNK);
+    }
+    // A pool read from a snapshot moves its strings into the arena, the
+    // table already has their ids
+    if (mapped_chars != nullptr){
+        std::vector<std::string_view> mapped(size());
+        for (uint32_t i = 0; i < mapped.size(); i++){
+            mapped[i] = get(i);
+        }
+        mapped_chars = nullptr;
+        mapped_offsets = array_view<uint64_t>();
+        strings.clear();
+        for (std::string_view mapped_str : mapped){
+            char* stored = static_cast<char*>(memory -> allocate(mapped_str.size() + 1, 1));
+            std::memcpy(stored, mapped_str.data(), mapped_str.size());
+            stored[mapped_str.size()] = '\0';
+            strings.push_back(std::string_view(stored, mapped_str.size()));
+        }
+    }
+
+    char* stored = static_cast<char*>(memory -> allocate(str.size() + 1, 1));
+    if (!str.empty()){
+        std::memcpy(stored, str.data(), str.size());
+    }
+    stored[str.size()] = '\0';
+    char_bytes += str.size();
+
+    id = strings.size();
+    strings.push_back(std::string_view(stored, str.size()));
+
+    // Keep the table at most half full
+    if (2*strings.size() > slots.size()){
+        size_t num_slots = std::max<size_t>(STRING_POOL_MIN_SLOTS, 2*slots.size());
+        while (2*strings.size() > num_slots){
+            num_slots *= 2;
+        }
+        slots.assign(num_slots, 0);
+        for (uint32_t i = 0; i < strings.size(); i++){
+            insertSlot(slots, hash(strings[i]), i);
+        }
+    }
+    else{
+        insertSlot(slots, hash(strings.back()), id);
+    }
+    return id;
+}
+
+uint32_t string_pool::find(std::string_view str) const{
+    if (slots.empty()){
+        return NO_STRING;
+    }
+    size_t mask = slots.size() - 1;
+    for (size_t slot = hash(str) & mask; slots[slot] != 0; slot = (slot + 1) & mask){
+        if (get(slots[slot] - 1) == str){
+            return slots[slot] - 1;
+        }
+    }
+    return NO_STRING;
+}
+
+void string_pool::view(const char* chars, const uint64_t* offsets, size_t num_strings, const uint32_t* table, size_t num_slots){
+    clear();
+    mapped_chars = chars;
+    mapped_offsets = array_view<uint64_t>(offsets, num_strings + 1);
+    char_bytes = offsets[num_strings] - num_strings;
+    slots.view(table, num_slots);
+}
+
+// 64-bit FNV-1a
+uint64_t string_pool::hash(std::string_view str){
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : str){
+        hash = (hash ^ uint8_t(c))*1099511628211ull;
+    }
+    return hash ^ (hash >> 32);
+}
+
+void string_pool::clear(){
+    // The characters go with the arena
+    memory.reset();
+    char_bytes = 0;
+    strings.clear();
+    mapped_chars = nullptr;
+    mapped_offsets = array_view<uint64_t>();
+    slots.clear();
+}
+
+// ------------- Helper Functions -------------
+
+// Puts id in the first empty slot from hash on, slots must have one
+void insertSlot(mapped_vector<uint32_t>& slots, uint64_t hash, uint32_t id){
+    size_t mask = slots.size() - 1;
+    size_t slot = hash & mask;
+    while (slots[slot] != 0){
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = id + 1;
+}
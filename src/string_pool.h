@@ -0,0 +1,86 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "array_view.h"
+#include "map_arena.h"
+#include "mapped_vector.h"
+
+// Id returned when a string is not in the pool
+constexpr uint32_t NO_STRING = UINT32_MAX;
+
+// Interns strings and hands out dense ids (0, 1, 2, ... in insertion order)
+// Each distinct string is stored once, in the pool's own arena, which draws
+// from the arena of the map it was first used in (see map_arena.h), so a pool
+// of millions of strings is freed a few chunks at a time. ids are found
+// through slots, an open addressing hash table of id + 1 (0 = empty) at most
+// half full. The string_views handed out stay valid as the pool grows, and
+// lookups by string_view never allocate
+//
+// A pool read from a map snapshot is used in place: string id is
+// mapped_chars[mapped_offsets[id]] up to the NUL before mapped_offsets[id + 1],
+// and slots is a view of the snapshot's table. Interning a new string into it
+// copies the strings into the arena first
+// Every stored string is followed by a NUL, so get(id).data() is also a C string
+struct string_pool{
+    // Character storage, made by the first intern
+    std::unique_ptr<map_arena> memory;
+    size_t char_bytes = 0;
+    // id -> string
+    std::vector<std::string_view> strings;
+    const char* mapped_chars = nullptr;
+    array_view<uint64_t> mapped_offsets;
+    // string -> id
+    mapped_vector<uint32_t> slots;
+
+    string_pool(){}
+
+    string_pool(string_pool&& other) noexcept
+        : memory(std::move(other.memory)), char_bytes(std::exchange(other.char_bytes, 0)), strings(std::move(other.strings)),
+          mapped_chars(std::exchange(other.mapped_chars, nullptr)), mapped_offsets(std::exchange(other.mapped_offsets, array_view<uint64_t>())),
+          slots(std::move(other.slots)){}
+
+    string_pool& operator=(string_pool&& other) noexcept{
+        std::swap(memory, other.memory);
+        std::swap(char_bytes, other.char_bytes);
+        std::swap(strings, other.strings);
+        std::swap(mapped_chars, other.mapped_chars);
+        std::swap(mapped_offsets, other.mapped_offsets);
+        std::swap(slots, other.slots);
+        return *this;
+    }
+
+    // Returns the id of str, adding it to the pool if it is new
+    uint32_t intern(std::string_view str);
+
+    // Returns the id of str, or NO_STRING if it was never interned
+    uint32_t find(std::string_view str) const;
+
+    std::string_view get(uint32_t id) const{
+        if (mapped_chars != nullptr){
+            return std::string_view(mapped_chars + mapped_offsets[id], mapped_offsets[id + 1] - mapped_offsets[id] - 1);
+        }
+        return strings[id];
+    }
+
+    size_t size() const{
+        return mapped_chars != nullptr ? mapped_offsets.size() - 1 : strings.size();
+    }
+
+    // Makes this a pool of the num_strings strings at chars, ended by the NULs
+    // before offsets[1] to offsets[num_strings], with the hash table at
+    // table. All three stay where they are
+    void view(const char* chars, const uint64_t* offsets, size_t num_strings, const uint32_t* table, size_t num_slots);
+
+    // Hash of str, what slots is keyed by. The same in every run, so the
+    // table can be saved
+    static uint64_t hash(std::string_view str);
+
+    void clear();
+};
+
+#endif /* STRING_POOL_H */
@@ -0,0 +1,92 @@
+#include "trace.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef MAPPER_TRACE
+
+// Ring buffer of one thread's spans, the next one goes to events[count % TRACE_BUFFER_EVENTS]
+struct trace_buffer{
+    int thread_id = 0;
+    uint64_t count = 0;
+    std::vector<trace_event> events;
+};
+
+// Every thread's buffer. Buffers are never freed, so spans of threads that
+// have finished (OpenMP workers of a past loadMap) are still written
+std::mutex trace_buffers_mutex;
+std::vector<std::unique_ptr<trace_buffer>> trace_buffers;
+thread_local trace_buffer* thread_trace_buffer = nullptr;
+
+int64_t traceNow(){
+    static const auto trace_start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_start).count();
+}
+
+void recordTraceEvent(const char* name, int64_t start_ns, int64_t end_ns){
+    // First span of this thread, the only time the lock is taken
+    if (thread_trace_buffer == nullptr){
+        std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+        trace_buffers.push_back(std::make_unique<trace_buffer>());
+        thread_trace_buffer = trace_buffers.back().get();
+        thread_trace_buffer -> thread_id = trace_buffers.size() - 1;
+        thread_trace_buffer -> events.resize(TRACE_BUFFER_EVENTS);
+    }
+
+    trace_buffer& buffer = *thread_trace_buffer;
+    buffer.events[buffer.count % TRACE_BUFFER_EVENTS] = {name, start_ns, end_ns - start_ns};
+    buffer.count++;
+}
+
+bool traceEnabled(){
+    return true;
+}
+
+void writeTraceJson(std::ostream& out){
+    std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+
+    // Chrome trace times are in microseconds. Names are string literals
+    // written by us, so they need no escaping
+    bool first = true;
+    out << "{\"traceEvents\": [";
+    for (auto const& buffer : trace_buffers){
+        out << (first ? "\n" : ",\n")
+            << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer -> thread_id
+            << ", \"args\": {\"name\": \"thread " << buffer -> thread_id << "\"}}";
+        first = false;
+
+        // Oldest kept span first
+        uint64_t begin = buffer -> count > TRACE_BUFFER_EVENTS ? buffer -> count - TRACE_BUFFER_EVENTS : 0;
+        for (uint64_t i = begin; i < buffer -> count; i++){
+            const trace_event& event = buffer -> events[i % TRACE_BUFFER_EVENTS];
+            out << ",\n  {\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer -> thread_id
+                << ", \"ts\": " << event.start_ns/1000 << "." << event.start_ns%1000/100
+                << ", \"dur\": " << event.duration_ns/1000 << "." << event.duration_ns%1000/100 << "}";
+        }
+    }
+    out << "\n]}" << std::endl;
+}
+
+void clearTrace(){
+    // Other threads keep pointers to their buffers, so empty them in place
+    std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+    for (auto& buffer : trace_buffers){
+        buffer -> count = 0;
+    }
+}
+
+#else
+
+bool traceEnabled(){
+    return false;
+}
+
+void writeTraceJson(std::ostream& out){
+    out << "{\"traceEvents\": []}" << std::endl;
+}
+
+void clearTrace(){
+}
+
+#endif /* MAPPER_TRACE */
@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <iostream>
+
+// Scoped tracing, compiled in by building with -DMAPPER_TRACE
+//
+// TRACE_SCOPE("name") records a span from that line to the end of the
+// enclosing scope. Spans go into a ring buffer per thread, so recording takes
+// no lock, and once a buffer holds TRACE_BUFFER_EVENTS spans the oldest are
+// overwritten. writeTraceJson dumps every buffer as Chrome trace JSON, which
+// chrome://tracing and ui.perfetto.dev open; spans inside other spans on the
+// same thread show up nested under them.
+// Without MAPPER_TRACE TRACE_SCOPE expands to nothing and costs nothing
+//
+// Names must be string literals (or otherwise outlive the trace), only the
+// pointer is stored
+
+// Spans kept per thread
+#define TRACE_BUFFER_EVENTS 65536
+
+struct trace_event{
+    const char* name;
+    // Nanoseconds since the first span of the process
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+#ifdef MAPPER_TRACE
+
+int64_t traceNow();
+void recordTraceEvent(const char* name, int64_t start_ns, int64_t end_ns);
+
+struct trace_scope{
+    const char* name;
+    int64_t start_ns;
+
+    explicit trace_scope(const char* scope_name) : name(scope_name), start_ns(traceNow()) {}
+    ~trace_scope(){
+        recordTraceEvent(name, start_ns, traceNow());
+    }
+    trace_scope(const trace_scope&) = delete;
+    trace_scope& operator=(const trace_scope&) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) trace_scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+
+#endif /* MAPPER_TRACE */
+
+// Whether this build records spans at all
+bool traceEnabled();
+
+// {"traceEvents": [...]} with one complete ("X") event per recorded span and
+// a thread name per thread. Call it while no other thread is recording
+void writeTraceJson(std::ostream& out);
+
+// Drops the recorded spans, the per-thread buffers are reused
+void clearTrace();
+
+#endif /* TRACE_H */